@@ -1,3 +1,3 @@
 include(CMakeFindDependencyMacro)
-find_dependency(SQLite3)
+find_dependency(SQLite3 3.35)
 include("${CMAKE_CURRENT_LIST_DIR}/zxormTargets.cmake")
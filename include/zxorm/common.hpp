@@ -15,6 +15,8 @@
 #include <sstream>
 #include <iterator>
 #include <optional>
+#include <span>
+#include <cstddef>
 #include "zxorm/logger.hpp"
 
 namespace zxorm {
@@ -96,6 +98,11 @@ namespace zxorm {
         template<typename T, auto s>
         struct is_array<std::array<T, s>> : std::true_type {};
 
+        template<typename T>
+        struct is_byte_span : std::false_type  { };
+        template<auto extent>
+        struct is_byte_span<std::span<const std::byte, extent>> : std::true_type {};
+
         template<typename T>
         struct is_optional : std::false_type  { };
         template<typename T>
@@ -106,7 +113,15 @@ namespace zxorm {
         template<typename T>
         static constexpr bool is_continuous_container() {
             using plain = typename remove_optional<std::remove_cvref_t<T>>::type;
-            return traits::is_vector<plain>() || traits::is_basic_string<plain>() || traits::is_array<plain>() || traits::is_basic_string_view<plain>();
+            return traits::is_vector<plain>() || traits::is_basic_string<plain>() || traits::is_array<plain>() || traits::is_basic_string_view<plain>() || traits::is_byte_span<plain>();
+        }
+
+        // views that do not own their data, when read from a statement
+        // they point directly into the row buffer owned by sqlite
+        template<typename T>
+        static constexpr bool is_borrowed_view() {
+            using plain = typename remove_optional<std::remove_cvref_t<T>>::type;
+            return traits::is_basic_string_view<plain>() || traits::is_byte_span<plain>();
         }
 
         template<typename T>
@@ -156,6 +171,9 @@ namespace zxorm {
     template<typename T>
     concept ContinuousContainer = ignore_qualifiers::is_continuous_container<T>();
 
+    template<typename T>
+    concept BorrowedView = ContinuousContainer<T> && ignore_qualifiers::is_borrowed_view<T>();
+
     template<typename T>
     concept ArithmeticT = ignore_qualifiers::is_arithmetic<T>() || std::is_convertible_v<T, int> || std::is_convertible_v<T, float>;
 
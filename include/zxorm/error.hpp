@@ -81,4 +81,9 @@ namespace zxorm {
         explicit InternalError(const char* const err, sqlite3* handle) : Error(err, handle) {}
     };
 
+    class ImportError : public Error {
+    public:
+        explicit ImportError(const std::string& message) : Error(message) {}
+    };
+
 };
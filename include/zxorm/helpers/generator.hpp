@@ -0,0 +1,130 @@
+/*
+* Copyright (c) 2023 Zach Gerstman
+* https://github.com/crabmandable/zxorm
+* This Source Code Form is subject to the terms of the Mozilla Public
+* License, v. 2.0. If a copy of the MPL was not distributed with this
+* file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*/
+#pragma once
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <utility>
+
+namespace zxorm {
+    /**
+     * Generator - a lazy coroutine, that is an input range of the values it yields
+     *
+     * Yielded values are not copied, the reference is only valid until the generator is resumed
+     */
+    template <typename T>
+    class Generator {
+    public:
+        struct promise_type {
+            T* current = nullptr;
+            std::exception_ptr error;
+
+            Generator get_return_object() {
+                return Generator{std::coroutine_handle<promise_type>::from_promise(*this)};
+            }
+
+            std::suspend_always initial_suspend() noexcept { return {}; }
+            std::suspend_always final_suspend() noexcept { return {}; }
+
+            std::suspend_always yield_value(T& value) noexcept {
+                current = std::addressof(value);
+                return {};
+            }
+
+            // the temporary lives until the generator is resumed
+            std::suspend_always yield_value(T&& value) noexcept {
+                current = std::addressof(value);
+                return {};
+            }
+
+            void return_void() noexcept {}
+
+            void unhandled_exception() {
+                error = std::current_exception();
+            }
+
+            // a generator only suspends when it yields
+            template <typename U>
+            std::suspend_never await_transform(U&&) = delete;
+        };
+
+    private:
+        std::coroutine_handle<promise_type> _handle;
+
+        explicit Generator(std::coroutine_handle<promise_type> handle) : _handle{handle} {}
+
+        void resume() {
+            if (_handle.done()) {
+                return;
+            }
+            _handle.resume();
+            if (_handle.promise().error) {
+                std::rethrow_exception(std::exchange(_handle.promise().error, nullptr));
+            }
+        }
+
+    public:
+        Generator(Generator&& other) noexcept : _handle{std::exchange(other._handle, nullptr)} {}
+
+        Generator& operator=(Generator&& other) noexcept {
+            if (this != &other) {
+                if (_handle) _handle.destroy();
+                _handle = std::exchange(other._handle, nullptr);
+            }
+            return *this;
+        }
+
+        Generator(const Generator&) = delete;
+        Generator& operator=(const Generator&) = delete;
+
+        ~Generator() {
+            if (_handle) _handle.destroy();
+        }
+
+        class iterator {
+            Generator* _generator = nullptr;
+        public:
+            using iterator_concept = std::input_iterator_tag;
+            using iterator_category = std::input_iterator_tag;
+            using value_type = std::remove_cvref_t<T>;
+            using difference_type = std::ptrdiff_t;
+
+            iterator() = default;
+            explicit iterator(Generator* generator) : _generator{generator} {}
+
+            iterator& operator++() {
+                _generator->resume();
+                return *this;
+            }
+
+            void operator++(int) {
+                ++(*this);
+            }
+
+            T& operator*() const {
+                return *_generator->_handle.promise().current;
+            }
+
+            bool operator==(std::default_sentinel_t) const {
+                return !_generator || _generator->_handle.done();
+            }
+        };
+
+        // runs the generator until it yields its first value
+        iterator begin() {
+            resume();
+            return iterator(this);
+        }
+
+        std::default_sentinel_t end() {
+            return std::default_sentinel;
+        }
+    };
+};
@@ -0,0 +1,88 @@
+/*
+* Copyright (c) 2023 Zach Gerstman
+* https://github.com/crabmandable/zxorm
+* This Source Code Form is subject to the terms of the Mozilla Public
+* License, v. 2.0. If a copy of the MPL was not distributed with this
+* file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*/
+#pragma once
+#include <charconv>
+#include <string>
+#include <string_view>
+
+namespace zxorm {
+    /**
+     * Query writers - the SQL for a query is written by a function taking
+     *                 `auto& out`, and using `out << std::string_view`.
+     *
+     *                 The same function can then be used to produce the
+     *                 string at compile time when everything is known from
+     *                 the template arguments, or at runtime when it isn't.
+     */
+
+    // counts the length of the query, so that a buffer of the right size can be created
+    struct SQLLengthCounter {
+        size_t size = 0;
+
+        constexpr SQLLengthCounter& operator<<(std::string_view str) {
+            size += str.size();
+            return *this;
+        }
+    };
+
+    // null terminated buffer written at compile time
+    template <size_t N>
+    struct StaticSQL {
+        char value[N + 1] = {};
+        size_t size = 0;
+
+        constexpr StaticSQL& operator<<(std::string_view str) {
+            for (char c : str) {
+                value[size++] = c;
+            }
+            return *this;
+        }
+
+        constexpr std::string_view view() const { return {value, N}; }
+        constexpr operator std::string_view() const { return view(); }
+    };
+
+    // writes to a `std::string` at runtime, for queries that depend on runtime values
+    struct SQLStringWriter {
+        std::string& out;
+
+        SQLStringWriter& operator<<(std::string_view str) {
+            out.append(str);
+            return *this;
+        }
+
+        SQLStringWriter& operator<<(unsigned long n) {
+            char buf[24];
+            auto [end, _] = std::to_chars(buf, buf + sizeof(buf), n);
+            out.append(buf, end);
+            return *this;
+        }
+    };
+
+    /**
+     * make_static_sql - writes a query at compile time
+     * @param Writer    - A default constructible callable that writes the query,
+     *                    e.g. `[](auto& out) { out << "SELECT 1;"; }`
+     */
+    template <typename Writer>
+    consteval auto make_static_sql() {
+        constexpr size_t size = [] {
+            SQLLengthCounter counter;
+            Writer{}(counter);
+            return counter.size;
+        }();
+
+        StaticSQL<size> sql;
+        Writer{}(sql);
+        return sql;
+    }
+
+    // the query generated by `Writer`, with static storage
+    template <typename Writer>
+    static constexpr auto static_sql_v = make_static_sql<Writer>();
+};
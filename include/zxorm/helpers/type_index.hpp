@@ -0,0 +1,30 @@
+/*
+* Copyright (c) 2023 Zach Gerstman
+* https://github.com/crabmandable/zxorm
+* This Source Code Form is subject to the terms of the Mozilla Public
+* License, v. 2.0. If a copy of the MPL was not distributed with this
+* file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*/
+#pragma once
+#include <atomic>
+#include <cstddef>
+
+namespace zxorm {
+    namespace __type_index_detail {
+        inline size_t next_index() {
+            static std::atomic<size_t> counter = 0;
+            return counter++;
+        }
+    };
+
+    /**
+     * type_index - a small, dense index for the type `T`,
+     *              assigned the first time it is used,
+     *              meaning it can be used to index into a vector
+     */
+    template <typename T>
+    size_t type_index() {
+        static const size_t index = __type_index_detail::next_index();
+        return index;
+    }
+};
@@ -0,0 +1,326 @@
+/*
+* Copyright (c) 2023 Zach Gerstman
+* https://github.com/crabmandable/zxorm
+* This Source Code Form is subject to the terms of the Mozilla Public
+* License, v. 2.0. If a copy of the MPL was not distributed with this
+* file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*/
+#pragma once
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "zxorm/orm/connection.hpp"
+#include "zxorm/orm/async_result.hpp"
+
+namespace zxorm {
+    namespace __async_detail {
+        template <typename T>
+        struct is_select_query : std::false_type {};
+
+        template <class Select, class Bindings>
+        struct is_select_query<PreparedSelectOne<Select, Bindings>> : std::true_type {};
+
+        template <class Select, class Bindings>
+        struct is_select_query<PreparedSelectMany<Select, Bindings>> : std::true_type {};
+    };
+
+    /**
+     * AsyncConnection - a `Connection` that is owned by its own executor thread
+     *
+     * Every call is queued and returns an `AsyncResult` immediately, the executor
+     * runs everything that was queued since its last wake up as one batch, in one
+     * transaction, with a savepoint for each request. The transaction takes the write
+     * lock up front, unless every request in the batch is known to only read.
+     * Requests are executed in the order they were made.
+     *
+     * A coroutine awaiting a result is resumed on the executor thread,
+     * unless a `resumer` is given, which can post the handle back to an event loop.
+     * A coroutine resumed on the executor should never block on another result
+     */
+    template <class... Table>
+    class AsyncConnection {
+    public:
+        using connection_t = Connection<Table...>;
+
+    private:
+        struct request {
+            std::function<void(connection_t&)> run;
+            // called once the batch has been committed, with the error if the request failed
+            std::function<void(std::exception_ptr)> complete;
+            // a batch that writes begins an immediate transaction,
+            // rather than upgrading its read lock part way through
+            bool writes = true;
+        };
+
+        resumer_t _resumer;
+        std::mutex _mutex;
+        std::condition_variable _cv;
+        std::deque<request> _queue;
+        bool _stopping = false;
+        std::thread _thread;
+
+        void run(std::string file_name, int flags, std::optional<std::string> z_vfs, Logger logger, std::promise<void> opened);
+        void run_batch(connection_t& connection, std::deque<request>& batch);
+        void enqueue(request r);
+
+        template <typename F>
+        auto enqueue_run(F&& run, bool writes) -> AsyncResult<std::invoke_result_t<std::decay_t<F>&, connection_t&>>;
+
+    public:
+        AsyncConnection(
+            const char* file_name,
+            int flags = SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE,
+            const char* z_vfs = nullptr,
+            Logger logger = nullptr,
+            resumer_t resumer = nullptr);
+
+        // runs everything that is still queued, then closes the connection
+        ~AsyncConnection();
+
+        AsyncConnection(const AsyncConnection&) = delete;
+        AsyncConnection& operator=(const AsyncConnection&) = delete;
+
+        /**
+         * submit - run `run(connection)` on the executor thread
+         *
+         * Anything returned must not refer to the connection's statements,
+         * e.g. a `RecordIterator` should be turned into a vector first
+         */
+        template <typename F>
+        auto submit(F&& run) -> AsyncResult<std::invoke_result_t<std::decay_t<F>&, connection_t&>>
+        { return enqueue_run(std::forward<F>(run), true); }
+
+        /**
+         * exec_query - build a query with `make_query(connection)` & execute it on the executor thread
+         *
+         * The results of a `many` query are returned as a vector
+         */
+        template <typename QueryFn>
+        auto exec_query(QueryFn&& make_query);
+
+        auto create_tables(bool if_not_exist = true)
+        { return submit([=](connection_t& c) { c.create_tables(if_not_exist); }); }
+
+        template<class T, typename PrimaryKeyType>
+        auto find_record(PrimaryKeyType id)
+        { return enqueue_run([id = std::move(id)](connection_t& c) { return c.template find_record<T>(id); }, false); }
+
+        template<class T, typename PrimaryKeyType>
+        auto delete_record(PrimaryKeyType id)
+        { return submit([id = std::move(id)](connection_t& c) { c.template delete_record<T>(id); }); }
+
+        // the result is the record, including its rowid once it has been inserted
+        template<class T>
+        auto insert_record(T record)
+        { return submit([record = std::move(record)](connection_t& c) mutable { c.insert_record(record); return std::move(record); }); }
+
+        template<class T>
+        auto upsert_record(T record)
+        { return submit([record = std::move(record)](connection_t& c) mutable { c.upsert_record(record); return std::move(record); }); }
+
+        template<class T>
+        auto update_record(T record)
+        { return submit([record = std::move(record)](connection_t& c) { c.update_record(record); }); }
+
+        template<class T>
+        auto insert_many_records(std::vector<T> records, size_t max_batch_size = 0)
+        { return submit([=, records = std::move(records)](connection_t& c) { return c.insert_many_records(records, max_batch_size); }); }
+
+        template<class T>
+        auto first()
+        { return enqueue_run([](connection_t& c) { return c.template first<T>(); }, false); }
+
+        template<class T>
+        auto last()
+        { return enqueue_run([](connection_t& c) { return c.template last<T>(); }, false); }
+    };
+
+    template <class... Table>
+    AsyncConnection<Table...>::AsyncConnection(
+            const char* file_name,
+            int flags,
+            const char* z_vfs,
+            Logger logger,
+            resumer_t resumer) : _resumer{std::move(resumer)}
+    {
+        std::optional<std::string> vfs;
+        if (z_vfs) {
+            vfs = z_vfs;
+        }
+
+        // the connection is opened on the executor, so that it is only ever used by one thread
+        std::promise<void> opened;
+        auto opened_future = opened.get_future();
+        _thread = std::thread([this, flags, file_name = std::string(file_name), vfs = std::move(vfs),
+                logger = std::move(logger), opened = std::move(opened)]() mutable {
+            run(std::move(file_name), flags, std::move(vfs), std::move(logger), std::move(opened));
+        });
+
+        try {
+            opened_future.get();
+        } catch (...) {
+            _thread.join();
+            throw;
+        }
+    }
+
+    template <class... Table>
+    AsyncConnection<Table...>::~AsyncConnection()
+    {
+        {
+            std::lock_guard lock(_mutex);
+            _stopping = true;
+        }
+        _cv.notify_one();
+        _thread.join();
+    }
+
+    template <class... Table>
+    void AsyncConnection<Table...>::run(std::string file_name, int flags, std::optional<std::string> z_vfs, Logger logger, std::promise<void> opened)
+    {
+        std::optional<connection_t> connection;
+        try {
+            connection.emplace(file_name.c_str(), flags, z_vfs ? z_vfs->c_str() : nullptr, std::move(logger));
+        } catch (...) {
+            opened.set_exception(std::current_exception());
+            return;
+        }
+        opened.set_value();
+
+        std::deque<request> batch;
+        while (true) {
+            {
+                std::unique_lock lock(_mutex);
+                _cv.wait(lock, [&]() { return _stopping || !_queue.empty(); });
+                if (_queue.empty()) {
+                    break;
+                }
+                std::swap(batch, _queue);
+            }
+
+            run_batch(*connection, batch);
+            batch.clear();
+        }
+    }
+
+    template <class... Table>
+    void AsyncConnection<Table...>::run_batch(connection_t& connection, std::deque<request>& batch)
+    {
+        std::vector<std::exception_ptr> errors(batch.size());
+
+        if (batch.size() == 1) {
+            try {
+                batch.front().run(connection);
+            } catch (...) {
+                errors.front() = std::current_exception();
+            }
+        } else {
+            // the writes in the batch share one commit, and a request that throws is rolled back alone
+            bool writes = std::any_of(batch.begin(), batch.end(), [](const request& r) { return r.writes; });
+            try {
+                auto transaction = connection.begin_transaction(writes ? transaction_mode_t::immediate : transaction_mode_t::deferred);
+                for (size_t i = 0; i < batch.size(); i++) {
+                    // after some errors sqlite rolls back the whole transaction, see `WriteQueue`
+                    if (!transaction.is_open()) {
+                        break;
+                    }
+                    try {
+                        auto savepoint = connection.begin_transaction();
+                        batch[i].run(connection);
+                        savepoint.commit();
+                    } catch (...) {
+                        errors[i] = std::current_exception();
+                    }
+                }
+                transaction.commit();
+            } catch (...) {
+                // nothing was committed
+                for (auto& error : errors) {
+                    if (!error) {
+                        error = std::current_exception();
+                    }
+                }
+            }
+        }
+
+        // outside of the transaction, since completing may resume a coroutine
+        for (size_t i = 0; i < batch.size(); i++) {
+            batch[i].complete(errors[i]);
+        }
+    }
+
+    template <class... Table>
+    void AsyncConnection<Table...>::enqueue(request r)
+    {
+        {
+            std::lock_guard lock(_mutex);
+            _queue.push_back(std::move(r));
+        }
+        _cv.notify_one();
+    }
+
+    template <class... Table>
+    template <typename F>
+    auto AsyncConnection<Table...>::enqueue_run(F&& run, bool writes) -> AsyncResult<std::invoke_result_t<std::decay_t<F>&, connection_t&>>
+    {
+        using result_t = std::invoke_result_t<std::decay_t<F>&, connection_t&>;
+        auto state = std::make_shared<__async_detail::shared_state<result_t>>();
+        state->resumer = _resumer;
+
+        // shared, so that move only callables can be stored in a `std::function`
+        auto shared_run = std::make_shared<std::decay_t<F>>(std::forward<F>(run));
+
+        // held until the batch is committed
+        auto value = std::make_shared<std::optional<__async_detail::value_t<result_t>>>();
+
+        enqueue(request{
+            .run = [shared_run, value](connection_t& connection) {
+                if constexpr (std::is_void_v<result_t>) {
+                    (*shared_run)(connection);
+                    value->emplace();
+                } else {
+                    value->emplace((*shared_run)(connection));
+                }
+            },
+            .complete = [state, value](std::exception_ptr error) {
+                if (error) {
+                    state->set_error(std::move(error));
+                } else {
+                    state->set_value(std::move(**value));
+                }
+            },
+            .writes = writes,
+        });
+
+        return AsyncResult<result_t>(std::move(state));
+    }
+
+    template <class... Table>
+    template <typename QueryFn>
+    auto AsyncConnection<Table...>::exec_query(QueryFn&& make_query)
+    {
+        using query_t = std::invoke_result_t<std::decay_t<QueryFn>&, connection_t&>;
+        constexpr bool writes = !__async_detail::is_select_query<query_t>::value;
+
+        return enqueue_run([make_query = std::forward<QueryFn>(make_query)](connection_t& connection) mutable {
+            auto query = make_query(connection);
+            if constexpr (std::is_void_v<decltype(query.exec())>) {
+                query.exec();
+            } else if constexpr (requires { query.exec().to_vector(); }) {
+                return query.exec().to_vector();
+            } else {
+                return query.exec();
+            }
+        }, writes);
+    }
+};
@@ -0,0 +1,143 @@
+/*
+* Copyright (c) 2023 Zach Gerstman
+* https://github.com/crabmandable/zxorm
+* This Source Code Form is subject to the terms of the Mozilla Public
+* License, v. 2.0. If a copy of the MPL was not distributed with this
+* file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*/
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <variant>
+
+#include "zxorm/error.hpp"
+
+namespace zxorm {
+    // decides where a coroutine waiting on an `AsyncResult` is resumed
+    using resumer_t = std::function<void(std::coroutine_handle<>)>;
+
+    namespace __async_detail {
+        template <typename T>
+        using value_t = std::conditional_t<std::is_void_v<T>, std::monostate, T>;
+
+        template <typename T>
+        struct shared_state {
+            std::mutex mutex;
+            std::condition_variable cv;
+            bool ready = false;
+            std::optional<value_t<T>> value;
+            std::exception_ptr error;
+            std::coroutine_handle<> waiter;
+            resumer_t resumer;
+
+            void finish() {
+                std::coroutine_handle<> to_resume;
+                {
+                    std::lock_guard lock(mutex);
+                    ready = true;
+                    to_resume = std::exchange(waiter, nullptr);
+                }
+                cv.notify_all();
+
+                if (to_resume) {
+                    if (resumer) {
+                        resumer(to_resume);
+                    } else {
+                        to_resume.resume();
+                    }
+                }
+            }
+
+            void set_value(value_t<T> v) {
+                value.emplace(std::move(v));
+                finish();
+            }
+
+            void set_error(std::exception_ptr e) {
+                error = std::move(e);
+                finish();
+            }
+        };
+    };
+
+    /**
+     * AsyncResult - the result of a query that is executed on another thread
+     *
+     * It can be waited on, like a future, or `co_await`ed from a coroutine.
+     * A result can only be consumed once, and should only be awaited by one coroutine
+     */
+    template <typename T>
+    class AsyncResult {
+        std::shared_ptr<__async_detail::shared_state<T>> _state;
+
+    public:
+        explicit AsyncResult(std::shared_ptr<__async_detail::shared_state<T>> state) : _state{std::move(state)} {}
+
+        AsyncResult(AsyncResult&&) = default;
+        AsyncResult& operator=(AsyncResult&&) = default;
+        AsyncResult(const AsyncResult&) = delete;
+        AsyncResult& operator=(const AsyncResult&) = delete;
+
+        bool ready() const {
+            std::lock_guard lock(_state->mutex);
+            return _state->ready;
+        }
+
+        void wait() const {
+            std::unique_lock lock(_state->mutex);
+            _state->cv.wait(lock, [&]() { return _state->ready; });
+        }
+
+        template <typename Rep, typename Period>
+        bool wait_for(std::chrono::duration<Rep, Period> timeout) const {
+            std::unique_lock lock(_state->mutex);
+            return _state->cv.wait_for(lock, timeout, [&]() { return _state->ready; });
+        }
+
+        /**
+         * get - block until the result is ready, and take it
+         *
+         * Any exception thrown by the query is re-thrown here
+         */
+        T get() {
+            wait();
+            if (_state->error) {
+                std::rethrow_exception(_state->error);
+            }
+
+            if constexpr (not std::is_void_v<T>) {
+                if (!_state->value) {
+                    throw InternalError("Async result has already been taken");
+                }
+                T value = std::move(*_state->value);
+                _state->value.reset();
+                return value;
+            }
+        }
+
+        bool await_ready() const {
+            return ready();
+        }
+
+        // returns false if the result became ready in the meantime, which resumes the coroutine immediately
+        bool await_suspend(std::coroutine_handle<> handle) {
+            std::lock_guard lock(_state->mutex);
+            if (_state->ready) {
+                return false;
+            }
+            _state->waiter = handle;
+            return true;
+        }
+
+        T await_resume() {
+            return get();
+        }
+    };
+};
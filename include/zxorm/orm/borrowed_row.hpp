@@ -0,0 +1,69 @@
+/*
+* Copyright (c) 2023 Zach Gerstman
+* https://github.com/crabmandable/zxorm
+* This Source Code Form is subject to the terms of the Mozilla Public
+* License, v. 2.0. If a copy of the MPL was not distributed with this
+* file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*/
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include "zxorm/orm/statement.hpp"
+
+namespace zxorm {
+    /**
+     * BorrowedRow - the result of a `one` query that selects borrowed views
+     *
+     * The views point into the row buffer owned by sqlite, so the statement is kept
+     * on the row for as long as this is alive. Once it is destroyed the statement is
+     * reset, releasing its read snapshot, unless the query has been executed again since.
+     *
+     * It is used like a `std::optional` of the row
+     */
+    template <typename return_t>
+    class BorrowedRow
+    {
+    private:
+        std::shared_ptr<Statement> _stmt;
+        size_t _read = 0;
+        std::optional<return_t> _row;
+
+        void release() noexcept {
+            if (_stmt && _stmt->read_count() == _read) {
+                _stmt->finish();
+            }
+            _stmt = nullptr;
+        }
+
+    public:
+        BorrowedRow() = default;
+        BorrowedRow(std::shared_ptr<Statement> stmt, return_t row) :
+            _stmt{std::move(stmt)}, _read{_stmt->read_count()}, _row{std::move(row)} { }
+
+        BorrowedRow(BorrowedRow&&) = default;
+        BorrowedRow& operator=(BorrowedRow&& other) {
+            release();
+            _stmt = std::move(other._stmt);
+            _read = other._read;
+            _row = std::move(other._row);
+            return *this;
+        }
+
+        ~BorrowedRow() {
+            release();
+        }
+
+        bool has_value() const { return _row.has_value(); }
+        explicit operator bool() const { return has_value(); }
+
+        return_t& value() { return _row.value(); }
+        const return_t& value() const { return _row.value(); }
+
+        return_t& operator*() { return *_row; }
+        const return_t& operator*() const { return *_row; }
+
+        return_t* operator->() { return &*_row; }
+        const return_t* operator->() const { return &*_row; }
+    };
+};
@@ -0,0 +1,165 @@
+/*
+* Copyright (c) 2023 Zach Gerstman
+* https://github.com/crabmandable/zxorm
+* This Source Code Form is subject to the terms of the Mozilla Public
+* License, v. 2.0. If a copy of the MPL was not distributed with this
+* file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*/
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include "zxorm/common.hpp"
+#include "zxorm/error.hpp"
+
+namespace zxorm {
+    struct buffered_writer_options_t {
+        // flush once this many records are buffered
+        size_t max_rows = 1000;
+        // flush once the buffered records are estimated to take this many bytes, 0 for no limit
+        size_t max_bytes = 0;
+        // flush once the oldest buffered record is this old, 0 for no limit
+        std::chrono::milliseconds max_age = std::chrono::seconds(1);
+    };
+
+    struct buffered_writer_stats_t {
+        size_t flushes = 0;
+        size_t rows = 0;
+        size_t statements = 0;
+        std::chrono::nanoseconds duration{0};
+    };
+
+    /**
+     * BufferedWriter - buffers records in memory, and inserts them into the connection
+     *                  in one transaction once a limit is reached, or when it is destroyed
+     *
+     * Limits are only checked when a record is written, or `flush_if_due` is called,
+     * there is no timer thread, since a connection can only be used by one thread.
+     * An error while flushing in the destructor is lost, so call `flush` first to see it.
+     */
+    template <class Connection, class T>
+    class BufferedWriter {
+        using table_t = typename Connection::template table_for_class_t<T>;
+
+        static_assert([]<typename... C>(std::tuple<C...>) {
+            return (!ignore_qualifiers::is_borrowed_view<typename C::member_t>() && ...);
+        }(typename table_t::columns_t{}), "Buffered records can't borrow their data");
+
+        Connection* _connection;
+        buffered_writer_options_t _options;
+        std::vector<T> _buffer;
+        size_t _bytes = 0;
+        std::chrono::steady_clock::time_point _oldest;
+        buffered_writer_stats_t _stats;
+
+        // an estimate, the record itself, plus the data owned by its containers
+        static size_t record_size(const T& record) {
+            size_t size = sizeof(T);
+            std::apply([&]<typename... C>(const C&...) {
+                ([&]() {
+                    using member_t = typename C::member_t;
+                    if constexpr (ignore_qualifiers::is_continuous_container<member_t>()) {
+                        const auto& value = C::getter(record);
+                        if constexpr (ignore_qualifiers::is_optional<member_t>()) {
+                            if (value) {
+                                size += value->size() * sizeof(typename remove_optional<member_t>::type::value_type);
+                            }
+                        } else {
+                            size += value.size() * sizeof(typename member_t::value_type);
+                        }
+                    }
+                }(), ...);
+            }, typename table_t::columns_t{});
+            return size;
+        }
+
+        bool is_due(std::chrono::steady_clock::time_point now) const {
+            if (_buffer.empty()) {
+                return false;
+            }
+            return _buffer.size() >= _options.max_rows
+                || (_options.max_bytes && _bytes >= _options.max_bytes)
+                || (_options.max_age.count() && now - _oldest >= _options.max_age);
+        }
+
+    public:
+        BufferedWriter(Connection& connection, buffered_writer_options_t options = {}) :
+            _connection{&connection}, _options{options}
+        {
+            if (_options.max_rows == 0) {
+                throw InternalError("A buffered writer has to buffer at least one row");
+            }
+            _buffer.reserve(_options.max_rows);
+        }
+
+        BufferedWriter(BufferedWriter&& other) noexcept :
+            _connection{std::exchange(other._connection, nullptr)},
+            _options{other._options},
+            _buffer{std::move(other._buffer)},
+            _bytes{std::exchange(other._bytes, 0)},
+            _oldest{other._oldest},
+            _stats{other._stats} {}
+
+        BufferedWriter(const BufferedWriter&) = delete;
+        BufferedWriter& operator=(const BufferedWriter&) = delete;
+        BufferedWriter& operator=(BufferedWriter&&) = delete;
+
+        ~BufferedWriter() {
+            if (!_connection) {
+                return;
+            }
+            try {
+                flush();
+            } catch (const Error&) {
+                // destructors can't throw
+            }
+        }
+
+        void write(T record) {
+            auto now = std::chrono::steady_clock::now();
+            if (_buffer.empty()) {
+                _oldest = now;
+            }
+            if (_options.max_bytes) {
+                _bytes += record_size(record);
+            }
+            _buffer.push_back(std::move(record));
+
+            if (is_due(now)) {
+                flush();
+            }
+        }
+
+        // @returns whether the buffer was flushed
+        bool flush_if_due() {
+            if (!is_due(std::chrono::steady_clock::now())) {
+                return false;
+            }
+            flush();
+            return true;
+        }
+
+        // if inserting fails, the records stay in the buffer
+        void flush() {
+            if (_buffer.empty()) {
+                return;
+            }
+
+            auto inserted = _connection->insert_many_records(_buffer);
+            _stats.flushes++;
+            _stats.rows += inserted.rows;
+            _stats.statements += inserted.statements;
+            _stats.duration += inserted.duration;
+
+            // the capacity is kept for the next batch
+            _buffer.clear();
+            _bytes = 0;
+        }
+
+        size_t size() const { return _buffer.size(); }
+        size_t bytes() const { return _bytes; }
+        const buffered_writer_stats_t& stats() const { return _stats; }
+    };
+};
@@ -0,0 +1,152 @@
+/*
+* Copyright (c) 2023 Zach Gerstman
+* https://github.com/crabmandable/zxorm
+* This Source Code Form is subject to the terms of the Mozilla Public
+* License, v. 2.0. If a copy of the MPL was not distributed with this
+* file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*/
+#pragma once
+#include <sqlite3.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <optional>
+#include <random>
+#include <thread>
+
+namespace zxorm {
+    /**
+     * busy_strategy_t - how long to wait for a lock that is held by another connection
+     *
+     * The waits back off exponentially, and each wait is shortened by a random
+     * fraction of up to `jitter`, so that waiting connections don't retry in lockstep
+     */
+    struct busy_strategy_t {
+        std::chrono::milliseconds initial_backoff = std::chrono::milliseconds(1);
+        std::chrono::milliseconds max_backoff = std::chrono::milliseconds(100);
+        double multiplier = 2.0;
+        double jitter = 0.5;
+        // the lock is given up on after waiting this long in total
+        std::chrono::milliseconds max_wait = std::chrono::seconds(5);
+        // a read that sqlite gives up on before the wait is over, e.g. to avoid a deadlock,
+        // is run again, up to this many times, within the same `max_wait`
+        size_t max_retries = 3;
+    };
+
+    struct busy_stats_t {
+        // each time a statement found the database locked
+        size_t busy_events = 0;
+        // the number of times the busy handler waited
+        size_t waits = 0;
+        // busy events that were given up on
+        size_t timeouts = 0;
+        // reads that were run again after being given up on
+        size_t retries = 0;
+        std::chrono::nanoseconds time_waiting{0};
+    };
+
+    /**
+     * BusyHandler - installed with `sqlite3_busy_handler`, so that a connection waits
+     *               for locks held by other connections, according to a `busy_strategy_t`
+     *
+     * A connection has one for its lifetime, which its statements refer to,
+     * it only waits once a strategy is installed.
+     * The stats are only updated by the thread using the connection
+     */
+    class BusyHandler {
+        sqlite3* _handle;
+        std::optional<busy_strategy_t> _strategy;
+        busy_stats_t _stats;
+        std::minstd_rand _random{std::random_device{}()};
+        std::chrono::steady_clock::time_point _busy_since;
+        // while a statement is being run again, its waits can't go past the deadline of its first run
+        std::optional<std::chrono::steady_clock::time_point> _deadline;
+
+        std::chrono::nanoseconds backoff(size_t attempt) {
+            double backoff = _strategy->initial_backoff.count() * std::pow(_strategy->multiplier, attempt);
+            backoff = std::min<double>(backoff, _strategy->max_backoff.count());
+            backoff *= 1.0 - _strategy->jitter * std::uniform_real_distribution<double>(0, 1)(_random);
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::duration<double, std::milli>(backoff));
+        }
+
+        void wait(std::chrono::nanoseconds duration) {
+            auto start = std::chrono::steady_clock::now();
+            std::this_thread::sleep_for(duration);
+            _stats.time_waiting += std::chrono::steady_clock::now() - start;
+        }
+
+        // sqlite's busy handler, returning 0 gives up & the statement returns SQLITE_BUSY
+        static int on_busy(void* self, int n_calls) {
+            auto& handler = *static_cast<BusyHandler*>(self);
+            auto now = std::chrono::steady_clock::now();
+            if (n_calls == 0) {
+                handler._busy_since = now;
+                handler._stats.busy_events++;
+            }
+
+            auto remaining = handler._strategy->max_wait - (now - handler._busy_since);
+            if (handler._deadline) {
+                remaining = std::min<std::chrono::nanoseconds>(remaining, *handler._deadline - now);
+            }
+            if (remaining <= std::chrono::nanoseconds::zero()) {
+                handler._stats.timeouts++;
+                return 0;
+            }
+
+            handler._stats.waits++;
+            handler.wait(std::min<std::chrono::nanoseconds>(handler.backoff(n_calls), remaining));
+            return 1;
+        }
+
+    public:
+        explicit BusyHandler(sqlite3* handle) : _handle{handle} {}
+
+        BusyHandler(const BusyHandler&) = delete;
+        BusyHandler& operator=(const BusyHandler&) = delete;
+
+        ~BusyHandler() {
+            if (_strategy) {
+                sqlite3_busy_handler(_handle, nullptr, nullptr);
+            }
+        }
+
+        // installing the handler replaces sqlite's busy timeout, and resets the stats
+        void install(busy_strategy_t strategy) {
+            _strategy = strategy;
+            _stats = {};
+            sqlite3_busy_handler(_handle, &BusyHandler::on_busy, this);
+        }
+
+        /**
+         * retry - run a read that is still busy again, after backing off,
+         *         until it isn't busy, or it has been run `max_retries` times
+         *
+         * @param started - when the read was first run, its waits, including any made
+         *                  while it was first run, are given up on `max_wait` after this
+         * @returns the result of the last run
+         */
+        int retry(int result, std::chrono::steady_clock::time_point started, auto&& run) {
+            if (!_strategy) {
+                return result;
+            }
+
+            _deadline = started + _strategy->max_wait;
+            for (size_t attempt = 0; (result & 0xff) == SQLITE_BUSY && attempt < _strategy->max_retries; attempt++) {
+                auto remaining = *_deadline - std::chrono::steady_clock::now();
+                if (remaining <= std::chrono::nanoseconds::zero()) {
+                    break;
+                }
+                _stats.retries++;
+                wait(std::min<std::chrono::nanoseconds>(backoff(attempt), remaining));
+                result = run();
+            }
+            _deadline = std::nullopt;
+
+            return result;
+        }
+
+        const std::optional<busy_strategy_t>& strategy() const { return _strategy; }
+        const busy_stats_t& stats() const { return _stats; }
+    };
+};
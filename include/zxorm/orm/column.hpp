@@ -57,21 +57,26 @@ namespace zxorm {
                 decltype(std::get<0>(remove_from_tuple<std::false_type, fk_or_false<Constraint>...>{}))
             > {};
 
+        template <typename... C>
+        static constexpr void write_constraints(auto& out, std::tuple<C...>) {
+            bool first = true;
+            ([&]() {
+                if (!first) out << " ";
+                first = false;
+                C::write(out);
+            }(), ...);
+        }
+
+        template <typename... C>
+        static constexpr bool has_not_null(std::tuple<C...>) {
+            return (constraint_is_not_null<C>::value || ...);
+        }
+
         static inline std::string constraint_creation_query(auto constraints) {
-            std::stringstream ss;
-            std::apply([&] (const auto&... c) {
-                ([&](){
-                    ss << c << " ";
-                }(), ...);
-            }, constraints);
-
-            std::string qstr = ss.str();
-            // erase trailing comma
-            if (qstr.size() >= 2) {
-                qstr.erase(qstr.end() - 1);
-            }
-
-            return qstr;
+            std::string str;
+            SQLStringWriter out{str};
+            write_constraints(out, constraints);
+            return str;
         }
     };
 
@@ -110,6 +115,8 @@ namespace zxorm {
 
         static constexpr bool is_primary_key = any_of<constraint_is_primary_key<Constraint>::value...>;
         static constexpr bool is_auto_inc_column = any_of<constraint_is_primary_key<Constraint>::value...> && sql_column_type == sqlite_column_type::INTEGER;
+        static constexpr bool is_unique = any_of<constraint_is_unique<Constraint>::value...>;
+        static constexpr bool is_not_null = __constraint_t_detail::has_not_null(constraints_t{});
 
         static constexpr auto name = column_name;
 
@@ -117,6 +124,12 @@ namespace zxorm {
         static const auto& getter(const auto& obj) { return obj.*M; };
         static void setter(auto& obj, auto arg) { obj.*M = arg; };
 
+        static constexpr bool has_constraints = std::tuple_size_v<constraints_t> > 0;
+
+        static constexpr void write_constraints(auto& out) {
+            __constraint_t_detail::write_constraints(out, constraints_t{});
+        }
+
         static std::string constraint_creation_query() {
             return __constraint_t_detail::constraint_creation_query(constraints_t{});
         }
@@ -189,12 +202,20 @@ namespace zxorm {
 
         static constexpr bool is_primary_key = any_of<constraint_is_primary_key<Constraint>::value...>;
         static constexpr bool is_auto_inc_column = any_of<constraint_is_primary_key<Constraint>::value...> && sql_column_type == sqlite_column_type::INTEGER;
+        static constexpr bool is_unique = any_of<constraint_is_unique<Constraint>::value...>;
+        static constexpr bool is_not_null = __constraint_t_detail::has_not_null(constraints_t{});
 
         static constexpr auto name = column_name;
 
         static auto& getter(auto& obj) { return (obj.*Getter)(); };
         static void setter(auto& obj, auto arg) { (obj.*Setter)(arg); };
 
+        static constexpr bool has_constraints = std::tuple_size_v<constraints_t> > 0;
+
+        static constexpr void write_constraints(auto& out) {
+            __constraint_t_detail::write_constraints(out, constraints_t{});
+        }
+
         static std::string constraint_creation_query() {
             return __constraint_t_detail::constraint_creation_query(constraints_t{});
         }
@@ -0,0 +1,176 @@
+/*
+* Copyright (c) 2023 Zach Gerstman
+* https://github.com/crabmandable/zxorm
+* This Source Code Form is subject to the terms of the Mozilla Public
+* License, v. 2.0. If a copy of the MPL was not distributed with this
+* file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*/
+#pragma once
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#include "zxorm/common.hpp"
+#include "zxorm/error.hpp"
+#include "zxorm/orm/statement.hpp"
+
+namespace zxorm {
+    /**
+     * __column_key - identifies a column in the results of a select
+     * @param Table  - The table the column belongs to, `void` for aggregates
+     * @param Column - The column, `void` for aggregates
+     * @param T      - The type the column is read as
+     */
+    template <typename Table, typename Column, typename T>
+    struct __column_key {
+        using table_t = Table;
+        using column_t = Column;
+        using value_t = T;
+    };
+
+    /**
+     * column_vector - every value of a single column in a contiguous vector
+     *
+     * `bool`s are stored as bytes, since a `std::vector<bool>` isn't contiguous
+     */
+    template <typename T>
+    struct column_vector {
+        static_assert(not ignore_qualifiers::is_borrowed_view<T>(),
+                "Borrowed views can't outlive the row they are read from, so they can't be read into columns");
+
+        using value_type = std::conditional_t<std::is_same_v<T, bool>, uint8_t, T>;
+
+        std::vector<value_type> values;
+
+        size_t size() const { return values.size(); }
+        void reserve(size_t n) { values.reserve(n); }
+        void clear() { values.clear(); }
+
+        const value_type& operator[](size_t idx) const { return values[idx]; }
+
+        void read(Statement& stmt, size_t idx) {
+            stmt.read_column(idx, values.emplace_back());
+        }
+    };
+
+    // a null value is default constructed, and flagged in the `nulls` bitmap
+    template <typename T>
+    struct column_vector<std::optional<T>> {
+        static_assert(not ignore_qualifiers::is_borrowed_view<T>(),
+                "Borrowed views can't outlive the row they are read from, so they can't be read into columns");
+
+        using value_type = std::conditional_t<std::is_same_v<T, bool>, uint8_t, T>;
+
+        std::vector<value_type> values;
+        std::vector<bool> nulls;
+
+        size_t size() const { return values.size(); }
+        void reserve(size_t n) { values.reserve(n); nulls.reserve(n); }
+        void clear() { values.clear(); nulls.clear(); }
+
+        const value_type& operator[](size_t idx) const { return values[idx]; }
+        bool is_null(size_t idx) const { return nulls[idx]; }
+
+        void read(Statement& stmt, size_t idx) {
+            auto& value = values.emplace_back();
+            bool is_null = stmt.column_is_null(idx);
+            nulls.push_back(is_null);
+            if (!is_null) {
+                stmt.read_column(idx, value);
+            }
+        }
+    };
+
+    /**
+     * ColumnResults - the results of a select, stored as one `column_vector` per column
+     *
+     * Columns can be accessed by their index in the results,
+     * or by their `Field` if it is only selected once
+     */
+    template <typename... Key>
+    class ColumnResults {
+        std::tuple<column_vector<typename Key::value_t>...> _columns;
+        size_t _size = 0;
+
+        template <typename F>
+        static constexpr size_t index_of_field() {
+            constexpr std::array<bool, sizeof...(Key)> matches = {
+                (std::is_same_v<typename Key::table_t, typename F::table_t> &&
+                 std::is_same_v<typename Key::column_t, typename F::column_t>)...
+            };
+            size_t found = sizeof...(Key);
+            for (size_t i = 0; i < matches.size(); i++) {
+                if (matches[i]) {
+                    found = found == sizeof...(Key) ? i : sizeof...(Key) + 1;
+                }
+            }
+            return found;
+        }
+
+    public:
+        static constexpr size_t n_columns = sizeof...(Key);
+
+        size_t size() const { return _size; }
+        bool empty() const { return _size == 0; }
+
+        void reserve(size_t n) {
+            std::apply([&](auto&... column) { (column.reserve(n), ...); }, _columns);
+        }
+
+        // keeps the capacity of each column, so the results can be refilled without reallocating
+        void clear() {
+            std::apply([&](auto&... column) { (column.clear(), ...); }, _columns);
+            _size = 0;
+        }
+
+        template <size_t idx>
+        auto& get() { return std::get<idx>(_columns); }
+
+        template <size_t idx>
+        const auto& get() const { return std::get<idx>(_columns); }
+
+        template <typename F>
+        requires (is_field<F>)
+        auto& get() {
+            constexpr size_t idx = index_of_field<F>();
+            static_assert(idx < sizeof...(Key), "Field is not selected exactly once in the query");
+            return std::get<idx>(_columns);
+        }
+
+        template <typename F>
+        requires (is_field<F>)
+        const auto& get() const {
+            constexpr size_t idx = index_of_field<F>();
+            static_assert(idx < sizeof...(Key), "Field is not selected exactly once in the query");
+            return std::get<idx>(_columns);
+        }
+
+        // appends the current row of the statement
+        void read_row(Statement& stmt) {
+            [&]<size_t... idx>(std::index_sequence<idx...>) {
+                (std::get<idx>(_columns).read(stmt, idx), ...);
+            }(std::index_sequence_for<Key...>{});
+            _size++;
+        }
+    };
+
+    template <typename Keys>
+    struct __column_results;
+
+    template <typename... Key>
+    struct __column_results<std::tuple<Key...>> : std::type_identity<ColumnResults<Key...>> {};
+
+    template <bool is_optional, typename Table, typename Columns>
+    struct __table_column_keys;
+
+    // the columns of an optional selection (e.g. from an outer join) are all nullable
+    template <bool is_optional, typename Table, typename... Column>
+    struct __table_column_keys<is_optional, Table, std::tuple<Column...>> : std::type_identity<std::tuple<
+        __column_key<Table, Column, std::conditional_t<is_optional,
+            std::optional<typename remove_optional<typename Column::member_t>::type>,
+            typename Column::member_t>>...
+    >> {};
+};
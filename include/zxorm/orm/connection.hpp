@@ -11,20 +11,51 @@
 #include "zxorm/common.hpp"
 #include "zxorm/error.hpp"
 #include "zxorm/orm/statement.hpp"
+#include "zxorm/orm/statement_cache.hpp"
 #include "zxorm/orm/record_iterator.hpp"
 #include "zxorm/orm/expression.hpp"
 #include "zxorm/orm/field.hpp"
+#include "zxorm/orm/pragma.hpp"
+#include "zxorm/orm/connection_options.hpp"
+#include "zxorm/orm/wal_checkpointer.hpp"
+#include "zxorm/orm/transaction.hpp"
+#include "zxorm/orm/buffered_writer.hpp"
+#include "zxorm/orm/importer.hpp"
 #include "zxorm/orm/query/builder/select_query_builder.hpp"
 #include "zxorm/orm/query/builder/delete_query_builder.hpp"
+#include "zxorm/orm/query/builder/update_query_builder.hpp"
+#include "zxorm/helpers/type_index.hpp"
+#include "zxorm/helpers/generator.hpp"
+#include <array>
+#include <bit>
+#include <chrono>
 #include <functional>
+#include <limits>
 #include <sstream>
 #include <memory>
 #include <optional>
+#include <ranges>
+#include <span>
 #include <type_traits>
-#include <unordered_map>
 #include <utility>
+#include <vector>
 
 namespace zxorm {
+    struct bulk_insert_stats_t {
+        size_t rows = 0;
+        size_t statements = 0;
+        std::chrono::nanoseconds duration{0};
+
+        double rows_per_second() const {
+            if (duration.count() == 0) return 0;
+            return rows / std::chrono::duration<double>(duration).count();
+        }
+    };
+
+    // passed to `insert_many_records` & `upsert_many_records` to set the rowid of every record
+    struct set_rowids_t { explicit set_rowids_t() = default; };
+    inline constexpr set_rowids_t set_rowids {};
+
     template <class... Table>
     class Connection {
     static_assert(sizeof...(Table) > 0, "Connection should contain at least one table");
@@ -35,26 +66,82 @@ namespace zxorm {
         db_handle_ptr _db_handle;
         std::shared_ptr<Logger> _logger;
 
-        // more complicated queries are omitted, since this is only relevant for things that can be cached
-        // i.e. queries that always have the same number of binds
-        enum class QueryCacheType {
-            find_record,
-            delete_record,
-            first,
-            last,
-        };
+        // declared after the handle, so that it is uninstalled before the handle is closed,
+        // statements only hold a weak reference, like they do to the logger
+        std::shared_ptr<BusyHandler> _busy_handler;
+
+        // statements for any query with the same SQL are reused,
+        // the builders only hold a weak reference, since they may outlive the connection
+        std::shared_ptr<StatementCache> _statement_cache;
+
+        // set while `cached_query` builds a query, which keeps its statement for as long as the
+        // connection is open, so it is prepared outside of the LRU cache, where it would stay leased,
+        // and other queries with the same SQL would never hit the cache
+        bool _preparing_uncached = false;
+
+        std::weak_ptr<StatementCache> builder_statement_cache() const {
+            if (_preparing_uncached) {
+                return {};
+            }
+            return _statement_cache;
+        }
+
+        // on the heap, so that open transactions can refer to it while the connection is moved
+        std::unique_ptr<TransactionControl> _transaction_control;
+
+        // queries whose shape is known from a type are cached by that type,
+        // the slot for each type is at `type_index<Tag>()`
+        std::vector<std::shared_ptr<void>> _cached_queries;
+
+        // declared last, so its thread is stopped first
+        std::unique_ptr<WalCheckpointer> _wal_checkpointer;
+
+        template <typename Tag>
+        std::shared_ptr<void>& cache_slot();
+
+        // the queries used by the basic operations, these double as their cache tags
+        template <class T> struct find_record_query;
+        template <class T> struct delete_record_query;
+        template <class T> struct first_query;
+        template <class T> struct last_query;
+
+        // insert & update don't use the query builders, so only the statement is cached
+        template <class T> struct insert_statement_tag {};
+        template <class T> struct upsert_statement_tag {};
+        template <class T, typename... UpdatedColumn> struct update_statement_tag {};
+
+        // bulk inserts are done in batches of a power of 2 rows, so the statement for each
+        // batch size is at the index of its log2, and all of them have compile time queries
+        static constexpr size_t max_insert_batch_size = 64;
+        using bulk_insert_statements_t = std::array<std::shared_ptr<Statement>, std::bit_width(max_insert_batch_size)>;
+        template <class T, bool set_rowids, bool upsert> struct bulk_insert_statements_tag {};
+        template <class T> struct max_rowid_statement_tag {};
+
+        template<class T, bool upsert>
+            size_t insert_batch_size(size_t max_batch_size);
+
+        // an upsert also binds the rowid, so that existing records are updated
+        template<bool bind_rowid, class T>
+            static void bind_insert_values(Statement& stmt, int& i, const T& record);
+
+        // the largest rowid in the table for `T`, or 0 if it is empty
+        template<class T>
+            int64_t max_rowid();
+
+        template<typename T, bool upsert, bool set_rowids, std::ranges::input_range Range>
+            bulk_insert_stats_t insert_many_records_impl (Range&& records, size_t max_batch_size);
 
-        std::unordered_map<
-            std::string_view, // table name
-            std::unordered_map<
-                QueryCacheType,
-                std::shared_ptr<BasePreparedQuery>
-            >
-        > _query_cache;
+        // bulk deletes use the same strategy as bulk inserts, but with a list of primary keys
+        static constexpr size_t max_delete_batch_size = 256;
+        using bulk_delete_statements_t = std::array<std::shared_ptr<Statement>, std::bit_width(max_delete_batch_size)>;
+        template <class T> struct bulk_delete_statements_tag {};
 
-        // theset don't use the query template
-        std::unordered_map<std::string_view /* table name */, std::shared_ptr<Statement>> _insert_statement_cache;
-        std::unordered_map<std::string_view /* table name */, std::shared_ptr<Statement>> _update_statement_cache;
+        // runs `run` in an immediate transaction, unless one is already open
+        template<typename F>
+            void with_transaction(F&& run);
+
+        template<typename... UpdatedColumn, class T>
+            void update_record_impl (const T& record);
 
         template<class C> struct index_of_table;
         template<FixedLengthString name> struct index_of_table_name;
@@ -85,8 +172,11 @@ namespace zxorm {
         template<class From>
         auto make_delete_query();
 
-        auto make_statement(const std::string& query);
-        void exec(const std::string& query);
+        template<class From>
+        auto make_update_query();
+
+        auto make_statement(std::string_view query);
+        void exec(std::string_view query);
 
         // The conditional makes it impossible to deduce the type T apparently :(
         // so the public inserts call this implementation
@@ -94,8 +184,19 @@ namespace zxorm {
             void insert_record_impl (
                     std::conditional_t<not std::is_const_v<T> && table_has_rowid<T>(), T&, const T&> record);
 
+        template<class T>
+            void upsert_record_impl (
+                    std::conditional_t<not std::is_const_v<T> && table_has_rowid<T>(), T&, const T&> record);
+
         void log(log_level level, const std::string_view& msg);
 
+        void apply_options(const ConnectionOptions& options);
+
+        template <typename V>
+        V pragma_value(std::string_view name);
+
+        void set_pragma(std::string_view name, std::string_view value);
+
     public:
 
         template<class C> struct table_for_class;
@@ -113,6 +214,15 @@ namespace zxorm {
             const char* file_name,
             int flags = SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE,
             const char* z_vfs = nullptr,
+            Logger logger = nullptr) :
+            Connection(file_name, ConnectionOptions{}, flags, z_vfs, std::move(logger)) {}
+
+        // the options are applied before the connection is used for anything else
+        Connection(
+            const char* file_name,
+            const ConnectionOptions& options,
+            int flags = SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE,
+            const char* z_vfs = nullptr,
             Logger logger = nullptr);
 
         Connection(Connection&& old) = default;
@@ -123,10 +233,52 @@ namespace zxorm {
         void create_tables(bool if_not_exist = true);
         size_t count_tables();
 
-        void transaction(std::function<void()> run);
+        /**
+         * begin_transaction - begin a transaction, or a savepoint if one is already open,
+         *                     which is rolled back unless it is committed
+         */
+        [[nodiscard]] Transaction begin_transaction(transaction_mode_t mode = transaction_mode_t::deferred)
+        { return Transaction(_transaction_control.get(), mode, _logger); }
+
+        // runs `run` in a transaction, which is rolled back if it throws
+        template<typename F>
+            void transaction(F&& run, transaction_mode_t mode = transaction_mode_t::deferred);
 
         template<class T>
-            void update_record (const T& record);
+            void update_record (const T& record)
+            { return update_record_impl<>(record); }
+
+        /**
+         * update_fields - update only the given fields of the record, using its primary key
+         *
+         * e.g. `update_fields<Field<T, "name">, Field<T, "age">>(record)`,
+         * each set of fields has its own cached statement
+         */
+        template<typename... Fields, class T>
+            void update_fields (const T& record)
+            {
+                static_assert(sizeof...(Fields) > 0, "At least one field should be updated");
+                static_assert((std::is_same_v<typename Fields::table_t, table_for_class_t<T>> && ...),
+                        "Fields to update should belong to the table being updated");
+                return update_record_impl<typename Fields::column_t...>(record);
+            }
+
+        /**
+         * update_many_records - update every record in the range, in a single transaction
+         *
+         * @param Fields - The fields to update, every column is updated if none are given
+         * @returns the number of rows that were updated
+         */
+        template<typename... Fields, std::ranges::input_range Range>
+            size_t update_many_records (Range&& records);
+
+        /**
+         * delete_many_records - delete the records with any of the primary keys in `ids`,
+         *                       in a single transaction
+         * @returns the number of rows that were deleted
+         */
+        template<class T, std::ranges::input_range Range>
+            size_t delete_many_records (Range&& ids);
 
         template<class T>
             void insert_record (const T& record)
@@ -140,21 +292,88 @@ namespace zxorm {
             void insert_record (T& record)
             { return insert_record_impl<T>(record); }
 
-        // matches stl containers, allowing template arg deduction
-        template<template<typename, typename> typename Container, typename T, typename Allocator>
-            void insert_many_records (const Container<T, Allocator>& records, size_t batch_size = 10)
-            { return insert_many_records<T>(records, batch_size); }
+        /**
+         * insert_many_records - insert every record in the range, in as few statements as possible
+         *
+         * @param records        - Any input range, the records are bound without copying them if
+         *                         it is a forward range of lvalues, otherwise each batch is buffered
+         * @param max_batch_size - Maximum rows per statement, by default it is decided by the
+         *                         number of columns & sqlite's limit on the number of variables
+         */
+        template<typename T, std::ranges::input_range Range>
+            bulk_insert_stats_t insert_many_records (Range&& records, size_t max_batch_size = 0)
+            { return insert_many_records_impl<T, false, false>(std::forward<Range>(records), max_batch_size); }
+
+        template<std::ranges::input_range Range>
+            bulk_insert_stats_t insert_many_records (Range&& records, size_t max_batch_size = 0)
+            {
+                using T = std::ranges::range_value_t<Range>;
+                return insert_many_records_impl<T, false, false>(std::forward<Range>(records), max_batch_size);
+            }
 
-        // matches std::array, allowing template arg deduction
-        template<template<typename, auto> typename Container, typename T, auto size>
-            void insert_many_records (const Container<T, size>& records, size_t batch_size = 10)
-            { return insert_many_records<T>(records, batch_size); }
+        /**
+         * insert_many_records - the same, but the rowid of every record is set, like `insert_record`
+         *
+         * The records must be a forward range of mutable records, with an integer primary key
+         */
+        template<std::ranges::forward_range Range>
+            bulk_insert_stats_t insert_many_records (Range&& records, set_rowids_t, size_t max_batch_size = 0)
+            {
+                using T = std::ranges::range_value_t<Range>;
+                return insert_many_records_impl<T, false, true>(std::forward<Range>(records), max_batch_size);
+            }
 
-        template<typename T, IndexableContainer<T> Container>
-            void insert_many_records (const Container& records, size_t batch_size = 10);
+        // buffers records in memory, and inserts them in batches, see `BufferedWriter`
+        template<class T>
+            [[nodiscard]] BufferedWriter<Connection, T> buffered_writer(buffered_writer_options_t options = {})
+            { return BufferedWriter<Connection, T>(*this, options); }
+
+        /**
+         * import_records - stream CSV or JSON lines into the table for `T`, see `Importer`
+         *
+         * Everything is imported in one transaction, or nothing is if an `ImportError` is thrown
+         */
+        template<class T>
+            import_stats_t import_records(std::istream& in, import_options_t options = {})
+            { return Importer<Connection, T>::run(*this, in, options); }
+
+        /**
+         * upsert_record - insert the record, or update the existing record if it
+         *                 conflicts with the primary key or a `Unique` column
+         *
+         * For an integer primary key, a rowid of 0 is never a conflict,
+         * and the rowid of the inserted/updated record is set on mutable records
+         */
+        template<class T>
+            void upsert_record (const T& record)
+            { return upsert_record_impl<const T>(record); }
+
+        template<class T>
+            requires (table_has_rowid<T>())
+            void upsert_record (T& record)
+            { return upsert_record_impl<T>(record); }
+
+        // the same as `insert_many_records`, but every record is upserted
+        template<typename T, std::ranges::input_range Range>
+            bulk_insert_stats_t upsert_many_records (Range&& records, size_t max_batch_size = 0)
+            { return insert_many_records_impl<T, true, false>(std::forward<Range>(records), max_batch_size); }
+
+        template<std::ranges::input_range Range>
+            bulk_insert_stats_t upsert_many_records (Range&& records, size_t max_batch_size = 0)
+            {
+                using T = std::ranges::range_value_t<Range>;
+                return insert_many_records_impl<T, true, false>(std::forward<Range>(records), max_batch_size);
+            }
+
+        template<std::ranges::forward_range Range>
+            bulk_insert_stats_t upsert_many_records (Range&& records, set_rowids_t, size_t max_batch_size = 0)
+            {
+                using T = std::ranges::range_value_t<Range>;
+                return insert_many_records_impl<T, true, true>(std::forward<Range>(records), max_batch_size);
+            }
 
         template<class T, typename PrimaryKeyType>
-            [[nodiscard]] std::optional<T> find_record(const PrimaryKeyType& id);
+            [[nodiscard]] auto find_record(const PrimaryKeyType& id);
 
         template<class T, typename PrimaryKeyType>
             void delete_record(const PrimaryKeyType& id);
@@ -162,9 +381,37 @@ namespace zxorm {
         template<class Select, typename From=void, class... Clauses>
             [[nodiscard]] auto select_query();
 
+        /**
+         * stream_chunks - read every record in chunks of up to `chunk_size`, ordered by primary key
+         *
+         * Each chunk is read by continuing from the last primary key of the chunk before it,
+         * so no read is held open while a chunk is processed, or while the generator is suspended.
+         * The connection must outlive the generator
+         */
+        template<class T>
+            [[nodiscard]] Generator<std::span<T>> stream_chunks(size_t chunk_size = 1000);
+
+        // `stream_chunks`, one record at a time
+        template<class T>
+            [[nodiscard]] Generator<T> stream_records(size_t chunk_size = 1000);
+
         template<class From>
             [[nodiscard]] auto delete_query();
 
+        template<class From>
+            [[nodiscard]] auto update_query();
+
+        /**
+         * cached_query - prepare a query once per connection, and reuse it
+         *
+         * @param make_query - A callable that builds the prepared query, taking the connection
+         *                     as an argument. Its type identifies the query, so it is only ever
+         *                     called once, and it shouldn't capture anything.
+         *                     Use `rebind` on the result to change the bindings.
+         */
+        template<typename QueryFn>
+            [[nodiscard]] auto& cached_query(QueryFn&& make_query);
+
 
         template<class T>
         [[nodiscard]] auto first();
@@ -176,6 +423,34 @@ namespace zxorm {
         void truncate();
 
         void set_foreign_keys(bool on);
+
+        // throws if sqlite can't use `mode`, e.g. `wal` for an in-memory database
+        void set_journal_mode(journal_mode_t mode);
+        journal_mode_t journal_mode();
+
+        // the options currently in effect, as reported by sqlite
+        ConnectionOptions options();
+
+        // wait for locks held by other connections with `strategy`, instead of failing straight away
+        void set_busy_strategy(busy_strategy_t strategy);
+        busy_stats_t busy_stats() const { return _busy_handler ? _busy_handler->stats() : busy_stats_t{}; }
+
+        // in pages, 0 turns automatic checkpoints off
+        void set_wal_autocheckpoint(int n_pages);
+
+        /**
+         * start_wal_checkpointer - checkpoint the WAL from a background thread,
+         *                          instead of inline when a transaction commits
+         *
+         * The connection has to be in WAL mode, and its `wal_autocheckpoint` is turned off
+         * until the checkpointer is stopped.
+         */
+        void start_wal_checkpointer(wal_checkpointer_options_t options = {});
+        void stop_wal_checkpointer();
+        [[nodiscard]] WalCheckpointer* wal_checkpointer() const { return _wal_checkpointer.get(); }
+
+        statement_cache_stats_t statement_cache_stats() const { return _statement_cache->stats(); }
+        void set_statement_cache_capacity(size_t capacity) { _statement_cache->set_capacity(capacity); }
     };
 
     template <class... Table>
@@ -188,6 +463,7 @@ namespace zxorm {
     template <class... Table>
     Connection<Table...>::Connection(
             const char* file_name,
+            const ConnectionOptions& options,
             int flags,
             const char* z_vfs,
             Logger logger)
@@ -222,7 +498,104 @@ namespace zxorm {
             }
         }};
 
-        set_foreign_keys(true);
+        _busy_handler = std::make_shared<BusyHandler>(_db_handle.get());
+
+        apply_options(options);
+
+        _statement_cache = std::make_shared<StatementCache>(_db_handle.get(), _logger, _busy_handler);
+        _transaction_control = std::make_unique<TransactionControl>(_db_handle.get(), _logger, _busy_handler);
+    }
+
+    template <class... Table>
+    void Connection<Table...>::set_pragma(std::string_view name, std::string_view value)
+    {
+        std::string query = "PRAGMA ";
+        query.append(name);
+        query.append(" = ");
+        query.append(value);
+        query.append(";");
+        exec(query);
+    }
+
+    template <class... Table>
+    template <typename V>
+    V Connection<Table...>::pragma_value(std::string_view name)
+    {
+        std::string query = "PRAGMA ";
+        query.append(name);
+        query.append(";");
+
+        auto stmt = make_statement(query);
+        stmt.step();
+        V value{};
+        if (!stmt.done()) {
+            stmt.read_column(0, value);
+        }
+        return value;
+    }
+
+    template <class... Table>
+    void Connection<Table...>::apply_options(const ConnectionOptions& options)
+    {
+        using namespace __pragma_enum_to_str;
+
+        // the page size has to be set before anything creates the database
+        if (options.page_size) {
+            set_pragma("page_size", std::to_string(*options.page_size));
+        }
+        // installing a busy handler clears sqlite's busy timeout, so the timeout becomes its budget
+        if (options.busy_strategy) {
+            auto strategy = *options.busy_strategy;
+            if (options.busy_timeout) {
+                strategy.max_wait = *options.busy_timeout;
+            }
+            set_busy_strategy(strategy);
+        } else if (options.busy_timeout) {
+            set_pragma("busy_timeout", std::to_string(options.busy_timeout->count()));
+        }
+        if (options.journal_mode) {
+            set_journal_mode(*options.journal_mode);
+        }
+        if (options.synchronous) {
+            set_pragma("synchronous", synchronous_str(*options.synchronous));
+        }
+        if (options.cache_size) {
+            set_pragma("cache_size", std::to_string(*options.cache_size));
+        }
+        if (options.mmap_size) {
+            set_pragma("mmap_size", std::to_string(*options.mmap_size));
+        }
+        if (options.temp_store) {
+            set_pragma("temp_store", temp_store_str(*options.temp_store));
+        }
+        if (options.threads) {
+            set_pragma("threads", std::to_string(*options.threads));
+        }
+        set_foreign_keys(options.foreign_keys);
+    }
+
+    template <class... Table>
+    ConnectionOptions Connection<Table...>::options()
+    {
+        // the integer values of these pragmas are in the same order as the enums
+        ConnectionOptions options = {
+            .foreign_keys = pragma_value<int64_t>("foreign_keys") != 0,
+            .journal_mode = journal_mode(),
+            .synchronous = static_cast<synchronous_t>(pragma_value<int64_t>("synchronous")),
+            .cache_size = pragma_value<int64_t>("cache_size"),
+            .mmap_size = pragma_value<int64_t>("mmap_size"),
+            .temp_store = static_cast<temp_store_t>(pragma_value<int64_t>("temp_store")),
+            .page_size = pragma_value<int64_t>("page_size"),
+            .busy_timeout = std::chrono::milliseconds(pragma_value<int64_t>("busy_timeout")),
+            .threads = pragma_value<int64_t>("threads"),
+        };
+
+        // sqlite reports a busy timeout of 0 while a busy handler is installed
+        if (_busy_handler->strategy()) {
+            options.busy_strategy = _busy_handler->strategy();
+            options.busy_timeout = _busy_handler->strategy()->max_wait;
+        }
+        return options;
     }
 
     template <class... Table>
@@ -548,7 +921,9 @@ namespace zxorm {
                 joins_tuple>
             (
                 _db_handle.get(),
-                _logger
+                _logger,
+                _busy_handler,
+                builder_statement_cache()
             );
 
         }
@@ -560,7 +935,9 @@ namespace zxorm {
 
             return SelectQueryBuilder<selectables_t, typename select_type<false, std::tuple<>, from_t, SelectOrTable>::type> (
                 _db_handle.get(),
-                _logger
+                _logger,
+                _busy_handler,
+                builder_statement_cache()
             );
         }
     }
@@ -571,40 +948,62 @@ namespace zxorm {
     {
         return DeleteQueryBuilder<table_for_class_t<From>>(
             _db_handle.get(),
-            _logger
+            _logger,
+            _busy_handler,
+            builder_statement_cache()
+        );
+    }
+
+    template <class... Table>
+    template<class From>
+    auto Connection<Table...>::make_update_query()
+    {
+        return UpdateQueryBuilder<table_for_class_t<From>>(
+            _db_handle.get(),
+            _logger,
+            _busy_handler,
+            builder_statement_cache()
         );
     }
 
     template <class... Table>
-    auto Connection<Table...>::make_statement(const std::string& query)
+    auto Connection<Table...>::make_statement(std::string_view query)
     {
-        return Statement(_db_handle.get(), _logger, query);
+        return Statement(_db_handle.get(), _logger, _busy_handler, query);
     }
 
     template <class... Table>
-    void Connection<Table...>::exec(const std::string& query)
+    void Connection<Table...>::exec(std::string_view query)
     {
         auto stmt = make_statement(query);
         stmt.step();
     }
 
     template <class... Table>
-    void Connection<Table...>::transaction(std::function<void()> run)
+    template<typename F>
+    void Connection<Table...>::transaction(F&& run, transaction_mode_t mode)
+    {
+        auto transaction = begin_transaction(mode);
+        run();
+        transaction.commit();
+    }
+
+    template <class... Table>
+    template<typename F>
+    void Connection<Table...>::with_transaction(F&& run)
     {
-        exec("BEGIN TRANSACTION;");
-        try {
+        if (!sqlite3_get_autocommit(_db_handle.get())) {
             run();
-        } catch(const zxorm::Error& err) {
-            exec("ROLLBACK TRANSACTION;");
-            throw;
+            return;
         }
 
-        exec("COMMIT TRANSACTION;");
-    };
+        // only used for writes, so the write lock may as well be taken up front
+        transaction(std::forward<F>(run), transaction_mode_t::immediate);
+    }
 
     template <class... Table>
-    template<class T>
-    void Connection<Table...>::update_record (const T& record)
+    template<typename... UpdatedColumn, class T>
+    void Connection<Table...>::update_record_impl (const T& record)
     {
         using table_t = table_for_class_t<T>;
         static_assert(table_t::has_primary_key, "Cannot execute an update on a table without a primary key");
@@ -617,82 +1016,357 @@ namespace zxorm {
             }
         }
 
-        auto& stmt = _update_statement_cache[table_t::name.value];
-        if (!stmt) {
-            Statement update_stmt = make_statement(table_t::update_query());
-            stmt = std::make_shared<Statement>(std::move(update_stmt));
-        } else {
-            stmt->reset();
+        auto& slot = cache_slot<update_statement_tag<table_t, UpdatedColumn...>>();
+        if (!slot) {
+            slot = std::make_shared<Statement>(make_statement(table_t::template static_update_query<UpdatedColumn...>()));
         }
 
+        auto stmt = std::static_pointer_cast<Statement>(slot);
+        stmt->reset();
+
+        // the record outlives the step, and the cached statement
+        // is always re-bound before it is stepped again, so nothing needs to be copied
         int i = 1;
         std::apply([&]<typename... U>(const U&...) {
             ([&]() {
-                if constexpr (not U::is_primary_key) {
-                    auto& val = U::getter(record);
-                    stmt->bind(i++, val);
+                auto& val = U::getter(record);
+                stmt->bind(i++, val, binding_storage_t::borrow);
+            }(), ...);
+        }, typename table_t::template update_columns_t<UpdatedColumn...>{});
+
+        stmt->bind(i++, pk, binding_storage_t::borrow);
+        stmt->step();
+
+        if (!stmt->done()) [[unlikely]] {
+            throw InternalError("Update query didn't run to completion");
+        }
+    }
+
+    template <class... Table>
+    template<class T, bool upsert>
+    size_t Connection<Table...>::insert_batch_size(size_t max_batch_size)
+    {
+        using table_t = table_for_class_t<T>;
+        constexpr size_t n_bound_columns = upsert ? table_t::n_columns : table_t::n_insert_columns;
+
+        size_t n_rows = max_insert_batch_size;
+        if constexpr (n_bound_columns > 0) {
+            size_t max_variables = sqlite3_limit(_db_handle.get(), SQLITE_LIMIT_VARIABLE_NUMBER, -1);
+            n_rows = std::min(n_rows, max_variables / n_bound_columns);
+        }
+        if (max_batch_size) {
+            n_rows = std::min(n_rows, max_batch_size);
+        }
+
+        return std::max<size_t>(std::bit_floor(n_rows), 1);
+    }
+
+    template <class... Table>
+    template<bool bind_rowid, class T>
+    void Connection<Table...>::bind_insert_values(Statement& stmt, int& i, const T& record)
+    {
+        using table_t = table_for_class_t<T>;
+
+        // the records always outlive the step, and cached insert statements
+        // are always re-bound before they are stepped again, so nothing needs to be copied
+        std::apply([&]<typename... U>(const U&...) {
+            ([&]() {
+                if constexpr (bind_rowid || !U::is_auto_inc_column) {
+                    const auto& val = U::getter(record);
+                    stmt.bind(i++, val, binding_storage_t::borrow);
                 }
 
             }(), ...);
         }, typename table_t::columns_t{});
+    }
 
-        stmt->bind(i++, pk);
+    template <class... Table>
+    template<class T>
+    int64_t Connection<Table...>::max_rowid()
+    {
+        using table_t = table_for_class_t<T>;
+
+        auto& slot = cache_slot<max_rowid_statement_tag<table_t>>();
+        if (!slot) {
+            slot = std::make_shared<Statement>(make_statement(table_t::static_max_rowid_query()));
+        }
+
+        auto stmt = std::static_pointer_cast<Statement>(slot);
+        stmt->reset();
         stmt->step();
 
-        if (!stmt->done()) [[unlikely]] {
-            throw InternalError("Update query didn't run to completion");
+        // `max` is NULL for an empty table, which is read as 0
+        int64_t rowid = 0;
+        if (!stmt->done()) {
+            stmt->read_column(0, rowid);
         }
+        stmt->finish();
+
+        return rowid;
     }
 
     template <class... Table>
-    template<typename T, IndexableContainer<T> Container>
-    void Connection<Table...>::insert_many_records (const Container& records, size_t batch_size)
+    template<typename T, bool upsert, bool set_rowids, std::ranges::input_range Range>
+    bulk_insert_stats_t Connection<Table...>::insert_many_records_impl (Range&& records, size_t max_batch_size)
     {
         using table_t = table_for_class_t<T>;
-        return transaction([&]() {
-            size_t inserted = 0;
-            // this should always be set
-            std::optional<Statement> insert_stmt;
-
-            while (inserted < records.size()) {
-                // iteration is less than batch size, query needs to be [re-]initialized
-                if (records.size() - inserted < batch_size) {
-                    batch_size = records.size() - inserted;
-                    auto query = table_t::insert_query(batch_size);
-                    insert_stmt = make_statement(query);
+        using reference_t = std::ranges::range_reference_t<Range>;
+
+        // otherwise the reference might not be valid once the iterator is incremented
+        constexpr bool borrow_records = std::ranges::forward_range<Range>
+            && std::is_lvalue_reference_v<reference_t>
+            && std::is_same_v<std::remove_cvref_t<reference_t>, T>;
+
+        if constexpr (set_rowids) {
+            static_assert(table_has_rowid<T>(), "Rowids can only be set for a table with an integer primary key");
+            static_assert(borrow_records && not std::is_const_v<std::remove_reference_t<reference_t>>,
+                    "Rowids can only be set on a range of mutable records");
+        }
+
+        using row_ptr_t = std::conditional_t<set_rowids, T*, const T*>;
+
+        auto start = std::chrono::steady_clock::now();
+        bulk_insert_stats_t stats;
+
+        const size_t batch_size = insert_batch_size<T, upsert>(max_batch_size);
+
+        auto& slot = cache_slot<bulk_insert_statements_tag<table_t, set_rowids, upsert>>();
+        if (!slot) {
+            slot = std::make_shared<bulk_insert_statements_t>();
+        }
+        auto& statements = *std::static_pointer_cast<bulk_insert_statements_t>(slot);
+
+        std::vector<row_ptr_t> batch;
+        batch.reserve(batch_size);
+
+        // only used when the records can't be borrowed,
+        // reserved up front so the pointers in `batch` are never invalidated
+        std::vector<T> buffer;
+        if constexpr (not borrow_records) {
+            buffer.reserve(batch_size);
+        }
+
+        // inserted rowids are chosen here, the same way sqlite would choose them,
+        // so that they are known without reading them back
+        int64_t next_rowid = 0;
+
+        // `n_rows` is always a power of 2
+        auto insert_rows = [&](const row_ptr_t* rows, size_t n_rows) {
+            auto& stmt = statements[std::countr_zero(n_rows)];
+            if (!stmt) {
+                auto query = table_t::template find_static_insert_query<set_rowids, upsert>(n_rows);
+                stmt = std::make_shared<Statement>(make_statement(query.value()));
+            } else {
+                stmt->reset();
+            }
+
+            int i = 1;
+            for (size_t row = 0; row < n_rows; row++) {
+                bind_insert_values<upsert || set_rowids>(*stmt, i, *rows[row]);
+            }
+
+            stmt->step();
+
+            // sqlite doesn't return the rows in any particular order, but a record can only have updated
+            // a row with a different rowid through a unique column, so its row has the same value in that column,
+            // every other record is in the row with the rowid it was bound with
+            if constexpr (upsert && set_rowids) {
+                for (; !stmt->done(); stmt->step()) {
+                    if constexpr (table_t::has_unique_columns) {
+                        int64_t rowid;
+                        stmt->read_column(0, rowid);
+
+                        size_t column_idx = 1;
+                        std::apply([&]<typename... U>(const U&...) {
+                            ([&] {
+                                if constexpr (U::is_unique && not U::is_primary_key) {
+                                    typename U::member_t value;
+                                    table_t::template read_column<U>(*stmt, column_idx++, value);
+                                    if constexpr (ignore_qualifiers::is_optional<typename U::member_t>()) {
+                                        // NULLs never conflict
+                                        if (!value.has_value()) {
+                                            return;
+                                        }
+                                    }
+                                    for (size_t row = 0; row < n_rows; row++) {
+                                        if (U::getter(*rows[row]) == value) {
+                                            table_t::primary_key_t::setter(*rows[row], rowid);
+                                        }
+                                    }
+                                }
+                            }(), ...);
+                        }, typename table_t::columns_t{});
+                    }
                 }
-                // first itertion, initiaize statement
-                else if (inserted == 0) {
-                    auto query = table_t::insert_query(batch_size);
-                    insert_stmt = make_statement(query);
-                // subsequent iterations just reset the same query
-                } else {
-                    insert_stmt.value().reset();
+            }
+
+            if (!stmt->done()) [[unlikely]] {
+                throw InternalError("Insert query didn't run to completion");
+            }
+
+            // a row that is ignored by a conflict clause would leave its record with a rowid that doesn't exist
+            if constexpr (set_rowids && not upsert) {
+                if (static_cast<size_t>(sqlite3_changes(_db_handle.get())) != n_rows) [[unlikely]] {
+                    throw InternalError("Insert query didn't insert every row, so the rowids can't be set");
+                }
+            }
+
+            stats.statements++;
+            stats.rows += n_rows;
+        };
+
+        with_transaction([&]() {
+            // the transaction is held until every record is inserted, so no other connection can take these rowids
+            if constexpr (set_rowids) {
+                next_rowid = max_rowid<T>();
+            }
+
+            for (auto&& record : records) {
+                if constexpr (set_rowids) {
+                    // an upserted record with a rowid keeps it, and sqlite would choose the next one after it
+                    int64_t rowid = upsert ? table_t::primary_key_t::getter(record) : 0;
+                    if (rowid) {
+                        next_rowid = std::max(next_rowid, rowid);
+                    } else if (next_rowid == std::numeric_limits<int64_t>::max()) [[unlikely]] {
+                        throw InternalError("The largest rowid is already used, so the rowids can't be chosen");
+                    } else {
+                        table_t::primary_key_t::setter(record, ++next_rowid);
+                    }
                 }
 
+                if constexpr (borrow_records) {
+                    batch.push_back(&record);
+                } else {
+                    batch.push_back(&buffer.emplace_back(std::forward<decltype(record)>(record)));
+                }
 
-                int i = 1;
-                for (size_t row = 0; row < batch_size; row++) {
-                    std::apply([&]<typename... U>(const U&...) {
-                        ([&]() {
-                            if constexpr (!U::is_auto_inc_column) {
-                                const auto& val = U::getter(records[row + inserted]);
-                                insert_stmt.value().bind(i++, val);
-                            }
+                if (batch.size() == batch_size) {
+                    insert_rows(batch.data(), batch_size);
+                    batch.clear();
+                    buffer.clear();
+                }
+            }
 
-                        }(), ...);
-                    }, typename table_t::columns_t{});
+            // the remainder is inserted with the batch sizes from the binary representation
+            // of its length, so every statement that is used is prepared only once
+            size_t offset = 0;
+            for (size_t n_rows = batch_size; n_rows > 0; n_rows >>= 1) {
+                if (batch.size() & n_rows) {
+                    insert_rows(batch.data() + offset, n_rows);
+                    offset += n_rows;
                 }
+            }
+        });
+
+        stats.duration = std::chrono::steady_clock::now() - start;
+        return stats;
+    }
+
+    template <class... Table>
+    template<typename... Fields, std::ranges::input_range Range>
+    size_t Connection<Table...>::update_many_records (Range&& records)
+    {
+        using T = std::ranges::range_value_t<Range>;
+        using table_t = table_for_class_t<T>;
+        static_assert((std::is_same_v<typename Fields::table_t, table_t> && ...),
+                "Fields to update should belong to the table being updated");
+
+        size_t n_updated = 0;
+        with_transaction([&]() {
+            for (const auto& record : records) {
+                update_record_impl<typename Fields::column_t...>(record);
+                n_updated += sqlite3_changes(_db_handle.get());
+            }
+        });
+
+        return n_updated;
+    }
+
+    template <class... Table>
+    template<class T, std::ranges::input_range Range>
+    size_t Connection<Table...>::delete_many_records (Range&& ids)
+    {
+        using table_t = table_for_class_t<T>;
+        static_assert(table_t::has_primary_key, "Cannot execute a delete on a table without a primary key");
+
+        using primary_key_t = typename table_t::primary_key_t;
+        using id_t = typename primary_key_t::member_t;
+        using reference_t = std::ranges::range_reference_t<Range>;
+
+        static_assert(std::is_convertible_v<reference_t, id_t>,
+                "Primary key type does not match the type specified in the definition of the table");
+
+        // see `insert_many_records_impl`
+        constexpr bool borrow_ids = std::ranges::forward_range<Range>
+            && std::is_lvalue_reference_v<reference_t>
+            && std::is_same_v<std::remove_cvref_t<reference_t>, id_t>;
+
+        size_t batch_size = max_delete_batch_size;
+        size_t max_variables = sqlite3_limit(_db_handle.get(), SQLITE_LIMIT_VARIABLE_NUMBER, -1);
+        batch_size = std::max<size_t>(std::bit_floor(std::min(batch_size, max_variables)), 1);
+
+        auto& slot = cache_slot<bulk_delete_statements_tag<table_t>>();
+        if (!slot) {
+            slot = std::make_shared<bulk_delete_statements_t>();
+        }
+        auto& statements = *std::static_pointer_cast<bulk_delete_statements_t>(slot);
+
+        std::vector<const id_t*> batch;
+        batch.reserve(batch_size);
+        std::vector<id_t> buffer;
+        if constexpr (not borrow_ids) {
+            buffer.reserve(batch_size);
+        }
+
+        size_t n_deleted = 0;
+
+        // `n_ids` is always a power of 2
+        auto delete_ids = [&](const id_t* const* batch_ids, size_t n_ids) {
+            auto& stmt = statements[std::countr_zero(n_ids)];
+            if (!stmt) {
+                stmt = std::make_shared<Statement>(make_statement(table_t::delete_query(n_ids)));
+            } else {
+                stmt->reset();
+            }
+
+            for (size_t i = 0; i < n_ids; i++) {
+                stmt->bind(i + 1, *batch_ids[i], binding_storage_t::borrow);
+            }
+
+            stmt->step();
+
+            if (!stmt->done()) [[unlikely]] {
+                throw InternalError("Delete query didn't run to completion");
+            }
 
-                insert_stmt.value().step();
+            n_deleted += sqlite3_changes(_db_handle.get());
+        };
 
-                if (!insert_stmt.value().done()) [[unlikely]] {
-                    throw InternalError("Insert query didn't run to completion");
+        with_transaction([&]() {
+            for (auto&& id : ids) {
+                if constexpr (borrow_ids) {
+                    batch.push_back(&id);
+                } else {
+                    batch.push_back(&buffer.emplace_back(std::forward<decltype(id)>(id)));
                 }
 
-                inserted += batch_size;
+                if (batch.size() == batch_size) {
+                    delete_ids(batch.data(), batch_size);
+                    batch.clear();
+                    buffer.clear();
+                }
+            }
+
+            size_t offset = 0;
+            for (size_t n_ids = batch_size; n_ids > 0; n_ids >>= 1) {
+                if (batch.size() & n_ids) {
+                    delete_ids(batch.data() + offset, n_ids);
+                    offset += n_ids;
+                }
             }
         });
+
+        return n_deleted;
     }
 
     template <class... Table>
@@ -702,27 +1376,16 @@ namespace zxorm {
     {
         using table_t = table_for_class_t<T>;
 
-        auto& stmt = _insert_statement_cache[table_t::name.value];
-
-        if (!stmt) {
-            auto query = table_t::insert_query();
-            Statement insert_stmt = make_statement(query);
-            stmt = std::make_shared<Statement>(std::move(insert_stmt));
-        } else {
-            stmt->reset();
+        auto& slot = cache_slot<insert_statement_tag<table_t>>();
+        if (!slot) {
+            slot = std::make_shared<Statement>(make_statement(table_t::static_insert_query()));
         }
 
+        auto stmt = std::static_pointer_cast<Statement>(slot);
+        stmt->reset();
 
         int i = 1;
-        std::apply([&]<typename... U>(const U&...) {
-            ([&]() {
-                if constexpr (!U::is_auto_inc_column) {
-                    auto& val = U::getter(record);
-                    stmt->bind(i++, val);
-                }
-
-            }(), ...);
-        }, typename table_t::columns_t{});
+        bind_insert_values<false>(*stmt, i, record);
 
         stmt->step();
 
@@ -736,11 +1399,52 @@ namespace zxorm {
         }
     }
 
+    template <class... Table>
+    template<class T>
+    void Connection<Table...>::upsert_record_impl (
+        std::conditional_t<not std::is_const_v<T> && table_has_rowid<T>(), T&, const T&> record)
+    {
+        using table_t = table_for_class_t<T>;
+
+        // `sqlite3_last_insert_rowid` isn't set when the record is updated,
+        // so the rowid is returned instead
+        constexpr bool set_rowid = not std::is_const_v<T> && table_has_rowid<T>();
+
+        auto& slot = cache_slot<upsert_statement_tag<T>>();
+        if (!slot) {
+            slot = std::make_shared<Statement>(make_statement(table_t::template static_upsert_query<1, set_rowid>()));
+        }
+
+        auto stmt = std::static_pointer_cast<Statement>(slot);
+        stmt->reset();
+
+        int i = 1;
+        bind_insert_values<true>(*stmt, i, record);
+
+        stmt->step();
+
+        if constexpr (set_rowid) {
+            if (stmt->done()) [[unlikely]] {
+                throw InternalError("Upsert query didn't return a rowid");
+            }
+
+            int64_t rowid;
+            stmt->read_column(0, rowid);
+            table_t::primary_key_t::setter(record, rowid);
+            stmt->step();
+        }
+
+        if (!stmt->done()) [[unlikely]] {
+            throw InternalError("Upsert query didn't run to completion");
+        }
+    }
+
     template <class... Table>
     void Connection<Table...>::create_tables(bool if_not_exist)
     {
-        std::array<Statement,  sizeof...(Table)> statements =
-            { make_statement(Table::create_table_query(if_not_exist))... };
+        std::array<Statement,  sizeof...(Table)> statements = { make_statement(if_not_exist
+                ? Table::template static_create_table_query<true>()
+                : Table::template static_create_table_query<false>())... };
 
         return transaction([&]() {
             for (auto& s : statements) {
@@ -763,7 +1467,7 @@ namespace zxorm {
 
     template <class... Table>
     template<class T, typename PrimaryKeyType>
-    std::optional<T> Connection<Table...>::find_record(const PrimaryKeyType& id)
+    auto Connection<Table...>::find_record(const PrimaryKeyType& id)
     {
         using table_t = table_for_class_t<T>;
         static_assert(table_t::has_primary_key, "Cannot execute a find on a table without a primary key");
@@ -773,20 +1477,9 @@ namespace zxorm {
         static_assert(std::is_convertible_v<PrimaryKeyType, typename primary_key_t::member_t>,
                 "Primary key type does not match the type specified in the definition of the table");
 
-        const char* table_name = table_t::name.value;
-        auto& cache_item = _query_cache[table_name][QueryCacheType::find_record];
-
-        auto e = Field<table_t, primary_key_t::name>() == id;
-        using query_t = decltype(make_select_query_builder<T>().where_one(e));
-
-        if (!cache_item) {
-            auto query = make_select_query_builder<T>().where_one(e);
-            cache_item = std::make_shared<query_t>(std::move(query));
-        } else {
-            std::static_pointer_cast<query_t>(cache_item)->rebind(id);
-        }
-
-        return std::static_pointer_cast<query_t>(cache_item)->exec();
+        auto& query = cached_query(find_record_query<T>{});
+        query.rebind(id);
+        return query.exec();
     }
 
     template <class... Table>
@@ -802,22 +1495,93 @@ namespace zxorm {
         static_assert(std::is_convertible_v<PrimaryKeyType, typename primary_key_t::member_t>,
                 "Primary key type does not match the type specified in the definition of the table");
 
-        const char* table_name = table_t::name.value;
-        auto& cache_item = _query_cache[table_name][QueryCacheType::delete_record];
+        auto& query = cached_query(delete_record_query<T>{});
+        query.rebind(id);
+        return query.exec();
+    }
+
+    template <class... Table>
+    template<typename Tag>
+    std::shared_ptr<void>& Connection<Table...>::cache_slot()
+    {
+        size_t idx = type_index<Tag>();
+        if (idx >= _cached_queries.size()) [[unlikely]] {
+            _cached_queries.resize(idx + 1);
+        }
+        return _cached_queries[idx];
+    }
 
-        auto e = Field<table_t, primary_key_t::name>() == id;
-        using query_t = decltype(make_delete_query<T>().where(e));
+    template <class... Table>
+    template<typename QueryFn>
+    auto& Connection<Table...>::cached_query(QueryFn&& make_query)
+    {
+        using tag_t = std::remove_cvref_t<QueryFn>;
+        static_assert(std::is_empty_v<tag_t>,
+                "The query is identified by the type of `make_query`, so it shouldn't capture anything");
+
+        using query_t = std::invoke_result_t<QueryFn, Connection&>;
+
+        if (!cache_slot<tag_t>()) [[unlikely]] {
+            // `make_query` may build other cached queries
+            bool was_preparing_uncached = std::exchange(_preparing_uncached, true);
+            std::shared_ptr<query_t> query;
+            try {
+                query = std::make_shared<query_t>(std::forward<QueryFn>(make_query)(*this));
+            } catch (...) {
+                _preparing_uncached = was_preparing_uncached;
+                throw;
+            }
+            _preparing_uncached = was_preparing_uncached;
 
-        if (!cache_item) {
-            auto query = make_delete_query<T>().where(e);
-            cache_item = std::make_shared<query_t>(std::move(query));
-        } else {
-            std::static_pointer_cast<query_t>(cache_item)->rebind(id);
+            // the slot is only looked up now, since caching those queries may have moved it
+            cache_slot<tag_t>() = std::move(query);
         }
 
-        return std::static_pointer_cast<query_t>(cache_item)->exec();
+        return *std::static_pointer_cast<query_t>(cache_slot<tag_t>());
     }
 
+    // the bindings are always the primary key type, so the query type is the same
+    // no matter what type was used to call `find_record`
+    template <class... Table>
+    template<class T>
+    struct Connection<Table...>::find_record_query {
+        auto operator()(Connection& connection) const {
+            using table_t = table_for_class_t<T>;
+            using primary_key_t = typename table_t::primary_key_t;
+            return connection.make_select_query_builder<T>()
+                .where_one(Field<table_t, primary_key_t::name>() == typename primary_key_t::member_t{});
+        }
+    };
+
+    template <class... Table>
+    template<class T>
+    struct Connection<Table...>::delete_record_query {
+        auto operator()(Connection& connection) const {
+            using table_t = table_for_class_t<T>;
+            using primary_key_t = typename table_t::primary_key_t;
+            return connection.make_delete_query<T>()
+                .where(Field<table_t, primary_key_t::name>() == typename primary_key_t::member_t{});
+        }
+    };
+
+    template <class... Table>
+    template<class T>
+    struct Connection<Table...>::first_query {
+        auto operator()(Connection& connection) const {
+            return connection.make_select_query_builder<T>().one();
+        }
+    };
+
+    template <class... Table>
+    template<class T>
+    struct Connection<Table...>::last_query {
+        auto operator()(Connection& connection) const {
+            using table_t = table_for_class_t<T>;
+            using pk_field = Field<table_t, table_t::primary_key_t::name>;
+            return connection.make_select_query_builder<T>().template order_by<pk_field>(order_t::DESC).one();
+        }
+    };
+
     template <class... Table>
     template<class From>
     auto Connection<Table...>::delete_query()
@@ -825,6 +1589,13 @@ namespace zxorm {
         return make_delete_query<From>();
     }
 
+    template <class... Table>
+    template<class From>
+    auto Connection<Table...>::update_query()
+    {
+        return make_update_query<From>();
+    }
+
     template <class... Table>
     template<typename Select, typename From, typename... Clauses>
     auto Connection<Table...>::select_query()
@@ -834,37 +1605,77 @@ namespace zxorm {
 
     template <class... Table>
     template<class T>
-    auto Connection<Table...>::first()
+    Generator<std::span<T>> Connection<Table...>::stream_chunks(size_t chunk_size)
     {
         using table_t = table_for_class_t<T>;
-        using query_t = decltype(make_select_query_builder<T>().one());
+        static_assert(table_t::has_primary_key, "Cannot stream records from a table without a primary key");
 
-        auto& cache_item = _query_cache[table_t::name.value][QueryCacheType::first];
+        using primary_key_t = typename table_t::primary_key_t;
+        using id_t = typename primary_key_t::member_t;
+        static_assert(std::is_arithmetic_v<id_t>, "Streaming records requires an arithmetic primary key");
+        using pk_field = Field<table_t, primary_key_t::name>;
 
-        if (!cache_item) {
-            auto query = make_select_query_builder<T>().one();
-            cache_item = std::make_shared<query_t>(std::move(query));
+        if (chunk_size == 0) {
+            throw InternalError("Chunk size must be greater than 0");
         }
 
-        return std::static_pointer_cast<query_t>(cache_item)->exec();
+        std::vector<T> chunk(chunk_size);
+        auto fetch_chunk = [&](auto& query) {
+            size_t n = query.fetch(chunk);
+            // ends the read before the chunk is handed out
+            query.rewind();
+            return n;
+        };
+
+        auto first_chunk = make_select_query_builder<T>()
+            .template order_by<pk_field>(order_t::ASC)
+            .limit(chunk_size)
+            .many();
+
+        auto next_chunk = make_select_query_builder<T>()
+            .template order_by<pk_field>(order_t::ASC)
+            .limit(chunk_size)
+            .where_many(pk_field() > id_t{});
+
+        size_t n = fetch_chunk(first_chunk);
+        while (n) {
+            id_t last_id = primary_key_t::getter(chunk[n - 1]);
+
+            std::span<T> rows(chunk.data(), n);
+            co_yield rows;
+
+            if (n < chunk_size) {
+                break;
+            }
+
+            next_chunk.rebind(last_id);
+            n = fetch_chunk(next_chunk);
+        }
     }
 
     template <class... Table>
     template<class T>
-    auto Connection<Table...>::last()
+    Generator<T> Connection<Table...>::stream_records(size_t chunk_size)
     {
-        using table_t = table_for_class_t<T>;
-        using query_t = decltype(make_select_query_builder<T>().one());
-        using pk_field = Field<table_t, table_t::primary_key_t::name>;
-
-        auto& cache_item = _query_cache[table_t::name.value][QueryCacheType::last];
-
-        if (!cache_item) {
-            auto query = make_select_query_builder<T>().template order_by<pk_field>(order_t::DESC).one();
-            cache_item = std::make_shared<query_t>(std::move(query));
+        for (std::span<T> chunk : stream_chunks<T>(chunk_size)) {
+            for (T& record : chunk) {
+                co_yield record;
+            }
         }
+    }
 
-        return std::static_pointer_cast<query_t>(cache_item)->exec();
+    template <class... Table>
+    template<class T>
+    auto Connection<Table...>::first()
+    {
+        return cached_query(first_query<T>{}).exec();
+    }
+
+    template <class... Table>
+    template<class T>
+    auto Connection<Table...>::last()
+    {
+        return cached_query(last_query<T>{}).exec();
     }
 
     template <class... Table>
@@ -883,4 +1694,72 @@ namespace zxorm {
         else
             exec("PRAGMA foreign_keys = OFF;");
     }
+
+    template <class... Table>
+    void Connection<Table...>::set_journal_mode(journal_mode_t mode)
+    {
+        std::string query = "PRAGMA journal_mode = ";
+        query.append(__pragma_enum_to_str::journal_mode_str(mode));
+        query.append(";");
+
+        // the pragma returns the mode that is in effect afterwards
+        auto stmt = make_statement(query);
+        stmt.step();
+        std::string result;
+        stmt.read_column(0, result);
+
+        if (__pragma_enum_to_str::journal_mode_from_str(result) != mode) {
+            auto err = InternalError("Unable to set journal mode");
+            log(log_level::Error, err);
+            throw err;
+        }
+    }
+
+    template <class... Table>
+    journal_mode_t Connection<Table...>::journal_mode()
+    {
+        auto stmt = make_statement("PRAGMA journal_mode;");
+        stmt.step();
+        std::string result;
+        stmt.read_column(0, result);
+
+        auto mode = __pragma_enum_to_str::journal_mode_from_str(result);
+        if (!mode) {
+            throw InternalError("Unknown journal mode");
+        }
+        return *mode;
+    }
+
+    template <class... Table>
+    void Connection<Table...>::start_wal_checkpointer(wal_checkpointer_options_t options)
+    {
+        _wal_checkpointer = nullptr;
+        _wal_checkpointer = std::make_unique<WalCheckpointer>(
+                sqlite3_db_filename(_db_handle.get(), "main"),
+                options,
+                _logger ? *_logger : Logger{});
+
+        set_wal_autocheckpoint(0);
+    }
+
+    template <class... Table>
+    void Connection<Table...>::stop_wal_checkpointer()
+    {
+        if (_wal_checkpointer) {
+            _wal_checkpointer = nullptr;
+            set_wal_autocheckpoint(WalCheckpointer::default_wal_autocheckpoint);
+        }
+    }
+
+    template <class... Table>
+    void Connection<Table...>::set_busy_strategy(busy_strategy_t strategy)
+    {
+        _busy_handler->install(strategy);
+    }
+
+    template <class... Table>
+    void Connection<Table...>::set_wal_autocheckpoint(int n_pages)
+    {
+        set_pragma("wal_autocheckpoint", std::to_string(n_pages));
+    }
 };
@@ -0,0 +1,74 @@
+/*
+* Copyright (c) 2023 Zach Gerstman
+* https://github.com/crabmandable/zxorm
+* This Source Code Form is subject to the terms of the Mozilla Public
+* License, v. 2.0. If a copy of the MPL was not distributed with this
+* file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*/
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <optional>
+
+#include "zxorm/orm/pragma.hpp"
+#include "zxorm/orm/busy_handler.hpp"
+
+namespace zxorm {
+    /**
+     * ConnectionOptions - pragmas that are applied when a connection is opened
+     *
+     * Anything left empty keeps sqlite's default.
+     * [The pragmas are documented here](https://www.sqlite.org/pragma.html)
+     */
+    struct ConnectionOptions {
+        bool foreign_keys = true;
+        std::optional<journal_mode_t> journal_mode = std::nullopt;
+        std::optional<synchronous_t> synchronous = std::nullopt;
+        // pages if positive, or KiB if negative
+        std::optional<int64_t> cache_size = std::nullopt;
+        // bytes
+        std::optional<int64_t> mmap_size = std::nullopt;
+        std::optional<temp_store_t> temp_store = std::nullopt;
+        // only has an effect before the database is created
+        std::optional<int64_t> page_size = std::nullopt;
+        std::optional<std::chrono::milliseconds> busy_timeout = std::nullopt;
+        // waits with backoff & retries, instead of sqlite's busy timeout,
+        // if both are set, the busy timeout replaces the strategy's `max_wait`
+        std::optional<busy_strategy_t> busy_strategy = std::nullopt;
+        // the maximum number of helper threads for a single statement
+        std::optional<int64_t> threads = std::nullopt;
+
+        // every transaction is flushed to disk before it is committed
+        static ConnectionOptions durable() {
+            return {
+                .journal_mode = journal_mode_t::wal,
+                .synchronous = synchronous_t::full,
+                .busy_timeout = std::chrono::seconds(5),
+            };
+        }
+
+        // for loading lots of data that can be loaded again,
+        // nothing is flushed to disk, so a power loss can corrupt the database
+        static ConnectionOptions fast_ingest() {
+            return {
+                .journal_mode = journal_mode_t::wal,
+                .synchronous = synchronous_t::off,
+                .cache_size = -256 * 1024,
+                .temp_store = temp_store_t::memory,
+                .busy_timeout = std::chrono::seconds(5),
+            };
+        }
+
+        // WAL, so readers don't block the writer, with a large cache and memory mapped reads
+        static ConnectionOptions read_mostly() {
+            return {
+                .journal_mode = journal_mode_t::wal,
+                .synchronous = synchronous_t::normal,
+                .cache_size = -64 * 1024,
+                .mmap_size = 256 * 1024 * 1024,
+                .temp_store = temp_store_t::memory,
+                .busy_timeout = std::chrono::seconds(5),
+            };
+        }
+    };
+};
@@ -0,0 +1,224 @@
+/*
+* Copyright (c) 2023 Zach Gerstman
+* https://github.com/crabmandable/zxorm
+* This Source Code Form is subject to the terms of the Mozilla Public
+* License, v. 2.0. If a copy of the MPL was not distributed with this
+* file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*/
+#pragma once
+#include <algorithm>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "zxorm/orm/connection.hpp"
+
+namespace zxorm {
+    /**
+     * ConnectionPool - read-only connections for concurrent reads, plus a single writer,
+     *                  to the same database in WAL mode
+     *
+     * A connection is leased by one thread at a time, and returned to the pool when the
+     * lease is destroyed. The most recently returned reader is leased first, so its
+     * statement cache is likely to be warm.
+     */
+    template <class... Table>
+    class ConnectionPool {
+    public:
+        using connection_t = Connection<Table...>;
+
+        static size_t default_n_readers() {
+            return std::max(1U, std::thread::hardware_concurrency());
+        }
+
+        class Lease {
+            ConnectionPool* _pool;
+            connection_t* _connection;
+            std::unique_lock<std::mutex> _writer_lock;
+
+            friend class ConnectionPool;
+
+            Lease(ConnectionPool* pool, connection_t* connection, std::unique_lock<std::mutex> writer_lock = {}) :
+                _pool{pool}, _connection{connection}, _writer_lock{std::move(writer_lock)} {}
+
+        public:
+            Lease(Lease&& other) noexcept :
+                _pool{std::exchange(other._pool, nullptr)},
+                _connection{std::exchange(other._connection, nullptr)},
+                _writer_lock{std::move(other._writer_lock)} {}
+
+            Lease(const Lease&) = delete;
+            Lease& operator=(const Lease&) = delete;
+            Lease& operator=(Lease&&) = delete;
+
+            ~Lease() {
+                // the writer is returned by unlocking it
+                if (_connection && !_writer_lock.owns_lock()) {
+                    _pool->release_reader(_connection);
+                }
+            }
+
+            connection_t& operator*() const { return *_connection; }
+            connection_t* operator->() const { return _connection; }
+        };
+
+    private:
+        std::unique_ptr<connection_t> _writer;
+        std::mutex _writer_mutex;
+
+        std::vector<std::unique_ptr<connection_t>> _readers;
+        // used as a stack, the back was returned most recently
+        std::vector<connection_t*> _idle_readers;
+        std::mutex _readers_mutex;
+        std::condition_variable _reader_returned;
+
+        std::string _file_name;
+        Logger _logger;
+        // declared last, so its thread is stopped first
+        std::unique_ptr<WalCheckpointer> _wal_checkpointer;
+
+        void release_reader(connection_t* reader) {
+            {
+                std::lock_guard lock(_readers_mutex);
+                _idle_readers.push_back(reader);
+            }
+            _reader_returned.notify_one();
+        }
+
+    public:
+        /**
+         * @param file_name - The database, which is created if it doesn't exist,
+         *                    and switched to WAL mode
+         * @param n_readers - The number of read-only connections
+         * @param options   - Applied to every connection, the journal mode is always WAL
+         */
+        ConnectionPool(const char* file_name, size_t n_readers = default_n_readers(), Logger logger = nullptr,
+                ConnectionOptions options = {});
+
+        ConnectionPool(const ConnectionPool&) = delete;
+        ConnectionPool& operator=(const ConnectionPool&) = delete;
+
+        // blocks until a reader is idle
+        [[nodiscard]] Lease reader();
+
+        // blocks until the writer is idle
+        [[nodiscard]] Lease writer();
+
+        size_t n_readers() const { return _readers.size(); }
+
+        // checkpoint the WAL from a background thread, instead of inline when the writer commits
+        void start_wal_checkpointer(wal_checkpointer_options_t options = {});
+        void stop_wal_checkpointer();
+        [[nodiscard]] WalCheckpointer* wal_checkpointer() const { return _wal_checkpointer.get(); }
+
+        template <typename F>
+        auto read(F&& run) { auto connection = reader(); return run(*connection); }
+
+        template <typename F>
+        auto write(F&& run) { auto connection = writer(); return run(*connection); }
+
+        void create_tables(bool if_not_exist = true)
+        { writer()->create_tables(if_not_exist); }
+
+        template<class T, typename PrimaryKeyType>
+        [[nodiscard]] auto find_record(const PrimaryKeyType& id)
+        { return reader()->template find_record<T>(id); }
+
+        template<class T>
+        [[nodiscard]] auto first()
+        { return reader()->template first<T>(); }
+
+        template<class T>
+        [[nodiscard]] auto last()
+        { return reader()->template last<T>(); }
+
+        template<class T>
+        void insert_record(T& record)
+        { writer()->insert_record(record); }
+
+        template<class T>
+        void upsert_record(T& record)
+        { writer()->upsert_record(record); }
+
+        template<class T>
+        void update_record(const T& record)
+        { writer()->update_record(record); }
+
+        template<class T, typename PrimaryKeyType>
+        void delete_record(const PrimaryKeyType& id)
+        { writer()->template delete_record<T>(id); }
+
+        template<std::ranges::input_range Range>
+        bulk_insert_stats_t insert_many_records(Range&& records, size_t max_batch_size = 0)
+        { return writer()->insert_many_records(std::forward<Range>(records), max_batch_size); }
+
+        // runs `run(writer)` in a transaction on the writer, which is immediate,
+        // since there is only one writer anyway
+        template <typename F>
+        void transaction(F&& run, transaction_mode_t mode = transaction_mode_t::immediate) {
+            auto connection = writer();
+            connection->transaction([&]() { run(*connection); }, mode);
+        }
+    };
+
+    template <class... Table>
+    ConnectionPool<Table...>::ConnectionPool(const char* file_name, size_t n_readers, Logger logger, ConnectionOptions options) :
+        _file_name{file_name}, _logger{logger}
+    {
+        if (n_readers == 0) {
+            throw InternalError("A connection pool needs at least one reader");
+        }
+
+        // the writer creates the database, and switches it to WAL mode, before any reader opens it
+        options.journal_mode = journal_mode_t::wal;
+        _writer = std::make_unique<connection_t>(file_name, options, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, nullptr, logger);
+
+        // readers can't change the journal mode
+        options.journal_mode = std::nullopt;
+
+        _readers.reserve(n_readers);
+        _idle_readers.reserve(n_readers);
+        for (size_t i = 0; i < n_readers; i++) {
+            _readers.push_back(std::make_unique<connection_t>(file_name, options, SQLITE_OPEN_READONLY, nullptr, logger));
+            _idle_readers.push_back(_readers.back().get());
+        }
+    }
+
+    template <class... Table>
+    auto ConnectionPool<Table...>::reader() -> Lease
+    {
+        std::unique_lock lock(_readers_mutex);
+        _reader_returned.wait(lock, [&]() { return !_idle_readers.empty(); });
+
+        auto reader = _idle_readers.back();
+        _idle_readers.pop_back();
+        return Lease(this, reader);
+    }
+
+    template <class... Table>
+    auto ConnectionPool<Table...>::writer() -> Lease
+    {
+        return Lease(this, _writer.get(), std::unique_lock(_writer_mutex));
+    }
+
+    template <class... Table>
+    void ConnectionPool<Table...>::start_wal_checkpointer(wal_checkpointer_options_t options)
+    {
+        _wal_checkpointer = nullptr;
+        _wal_checkpointer = std::make_unique<WalCheckpointer>(_file_name.c_str(), options, _logger);
+        writer()->set_wal_autocheckpoint(0);
+    }
+
+    template <class... Table>
+    void ConnectionPool<Table...>::stop_wal_checkpointer()
+    {
+        if (_wal_checkpointer) {
+            _wal_checkpointer = nullptr;
+            writer()->set_wal_autocheckpoint(WalCheckpointer::default_wal_autocheckpoint);
+        }
+    }
+};
@@ -8,6 +8,7 @@
 #pragma once
 
 #include "zxorm/common.hpp"
+#include "zxorm/helpers/static_sql.hpp"
 #include <sstream>
 #include <string>
 #include <type_traits>
@@ -73,13 +74,18 @@ namespace zxorm {
         static constexpr auto table_name = _table_name;
         static constexpr auto column_name = _column_name;
 
-        static std::string to_string() {
-            std::ostringstream ss;
-            ss << "REFERENCES `" << table_name.value << "` "
+        static constexpr void write(auto& out) {
+            out << "REFERENCES `" << table_name.value << "` "
                 << "(`" << column_name.value << "`)"
                 << " ON UPDATE " << __constraint_enum_to_str::action_str(on_update)
                 << " ON DELETE " << __constraint_enum_to_str::action_str(on_delete);
-            return ss.str();
+        }
+
+        static std::string to_string() {
+            std::string str;
+            SQLStringWriter out{str};
+            write(out);
+            return str;
         }
 
         friend std::ostream & operator<< (std::ostream &out, [[maybe_unused]] const ForeignKey& c)
@@ -92,10 +98,15 @@ namespace zxorm {
     // TODO support default with expr
     template<FixedLengthString value>
     struct Default {
+        static constexpr void write(auto& out) {
+            out << "DEFAULT '" << value.value << "'";
+        }
+
         static std::string to_string() {
-            std::ostringstream ss;
-            ss << "DEFAULT '" << value.value << "'";
-            return ss.str();
+            std::string str;
+            SQLStringWriter out{str};
+            write(out);
+            return str;
         }
 
         friend std::ostream & operator<< (std::ostream &out, [[maybe_unused]] const Default& c)
@@ -113,10 +124,15 @@ namespace zxorm {
 
     template<FixedLengthString value>
     struct Collate {
+        static constexpr void write(auto& out) {
+            out << "COLLATE " << value.value;
+        }
+
         static std::string to_string() {
-            std::stringstream ss;
-            ss << "COLLATE " << value.value;
-            return ss.str();
+            std::string str;
+            SQLStringWriter out{str};
+            write(out);
+            return str;
         }
 
         friend std::ostream & operator<< (std::ostream &out, [[maybe_unused]] const Collate& c)
@@ -128,10 +144,15 @@ namespace zxorm {
 
     template<FixedLengthString constraint, conflict_t on_conflict>
     struct ConstraintWithConflictClause {
+        static constexpr void write(auto& out) {
+            out << constraint.value << " ON CONFLICT " << __constraint_enum_to_str::conflict_str(on_conflict);
+        }
+
         static std::string to_string() {
-            std::stringstream ss;
-            ss << constraint.value << " ON CONFLICT " << __constraint_enum_to_str::conflict_str(on_conflict);
-            return ss.str();
+            std::string str;
+            SQLStringWriter out{str};
+            write(out);
+            return str;
         }
 
         friend std::ostream & operator<< (std::ostream &out,
@@ -145,6 +166,12 @@ namespace zxorm {
     template<conflict_t on_conflict=conflict_t::abort>
     using Unique = ConstraintWithConflictClause<"UNIQUE", on_conflict>;
 
+    template <typename T>
+    struct constraint_is_unique : std::false_type {};
+
+    template <auto T>
+    struct constraint_is_unique<Unique<T>> : std::true_type {};
+
     template<conflict_t on_conflict=conflict_t::abort>
     using NotNull = ConstraintWithConflictClause<"NOT NULL", on_conflict>;
 
@@ -24,45 +24,38 @@ namespace zxorm {
         NOT_IN,
     };
 
-    static inline std::ostream & operator<< (std::ostream &out, const comparison_op_t& op) {
+    static inline constexpr const char* comparison_op_str(comparison_op_t op) {
         switch (op) {
             case comparison_op_t::EQ:
-                out << " = ";
-                break;
+                return " = ";
             case comparison_op_t::NE:
-                out << " != ";
-                break;
+                return " != ";
             case comparison_op_t::LT:
-                out << " < ";
-                break;
+                return " < ";
             case comparison_op_t::LTE:
-                out << " <= ";
-                break;
+                return " <= ";
             case comparison_op_t::GT:
-                out << " > ";
-                break;
+                return " > ";
             case comparison_op_t::GTE:
-                out << " >= ";
-                break;
+                return " >= ";
             case comparison_op_t::LIKE:
-                out << " LIKE ";
-                break;
+                return " LIKE ";
             case comparison_op_t::NOT_LIKE:
-                out << " NOT LIKE ";
-                break;
+                return " NOT LIKE ";
             case comparison_op_t::GLOB:
-                out << " GLOB ";
-                break;
+                return " GLOB ";
             case comparison_op_t::NOT_GLOB:
-                out << " NOT GLOB ";
-                break;
+                return " NOT GLOB ";
             case comparison_op_t::IN:
-                out << " IN ";
-                break;
+                return " IN ";
             case comparison_op_t::NOT_IN:
-                out << " NOT IN ";
-                break;
+                return " NOT IN ";
         }
+        return "OOPS";
+    }
+
+    static inline std::ostream & operator<< (std::ostream &out, const comparison_op_t& op) {
+        out << comparison_op_str(op);
         return out;
     }
 
@@ -71,15 +64,18 @@ namespace zxorm {
         OR,
     };
 
-    static inline std::ostream & operator<< (std::ostream &out, const boolean_op_t& op) {
+    static inline constexpr const char* boolean_op_str(boolean_op_t op) {
         switch (op) {
             case boolean_op_t::AND:
-                out << " and ";
-                break;
+                return " and ";
             case boolean_op_t::OR:
-                out << " or ";
-                break;
+                return " or ";
         }
+        return "OOPS";
+    }
+
+    static inline std::ostream & operator<< (std::ostream &out, const boolean_op_t& op) {
+        out << boolean_op_str(op);
         return out;
     }
 
@@ -105,10 +101,18 @@ namespace zxorm {
             return ExpressionExpression<boolean_op_t::OR, decltype(*this), Expression>(*this, other);
         }
 
+        void serialize(std::string& out) const {
+            out.append("(");
+            lhs.serialize(out);
+            out.append(boolean_op_str(op));
+            rhs.serialize(out);
+            out.append(")");
+        }
+
         std::string serialize() const {
-            std::stringstream ss;
-            ss << "(" << lhs << op << rhs << ")";
-            return ss.str();
+            std::string str;
+            serialize(str);
+            return str;
         }
 
         friend std::ostream & operator<< (std::ostream &out, const ExpressionExpression& e) {
@@ -137,20 +141,28 @@ namespace zxorm {
             return ExpressionExpression<boolean_op_t::OR, decltype(*this), Expression>(*this, other);
         }
 
-        std::string serialize() const {
-            std::stringstream ss;
-            ss << "`" << Table::name.value << "`.`" << Column::name.value << "` " << op;
+        void serialize(std::string& out) const {
+            out.append("`");
+            out.append(Table::name.value);
+            out.append("`.`");
+            out.append(Column::name.value);
+            out.append("` ");
+            out.append(comparison_op_str(op));
             if constexpr (op == comparison_op_t::IN || op == comparison_op_t::NOT_IN) {
-                ss << " (";
+                out.append(" (");
                 for (size_t i = 0; i < to_bind.size(); i++) {
-                    ss << "?,";
+                    out.append(i ? ",?" : "?");
                 }
-                ss.seekp(-1, std::ios_base::end);
-                ss << ") ";
+                out.append(") ");
             } else {
-                ss << " ?";
+                out.append(" ?");
             }
-            return ss.str();
+        }
+
+        std::string serialize() const {
+            std::string str;
+            serialize(str);
+            return str;
         }
 
         friend std::ostream & operator<< (std::ostream &out, const ColumnExpression& e) {
@@ -163,4 +175,21 @@ namespace zxorm {
         }
     };
 
+    // `column = ?`, as written in the `SET` clause of an update
+    template <typename Table, typename Column, typename T>
+    struct SetExpression {
+        using table_t = Table;
+        using column_t = Column;
+        T to_bind;
+        SetExpression(T value) : to_bind{std::move(value)} {}
+
+        static constexpr void write(auto& out) {
+            out << "`" << Column::name.value << "` = ?";
+        }
+
+        auto bindings() const {
+            return std::tuple(to_bind);
+        }
+    };
+
 };
@@ -14,6 +14,7 @@ namespace zxorm {
     struct is_multi_value_binding : std::bool_constant<
         not traits::is_basic_string<Container>::value &&
         not traits::is_basic_string_view<Container>::value &&
+        not traits::is_byte_span<Container>::value &&
             is_indexable_container<Container>::value
     >{};
 
@@ -31,6 +32,13 @@ namespace zxorm {
         static constexpr auto name = _name;
         using table_t = Table;
 
+        // not an assignment, it makes the `SET` expression for an update query
+        template <typename M>
+        requires (std::is_convertible_v<M, typename column_t::member_t>)
+        SetExpression<Table, column_t, typename column_t::member_t> operator=(M value) {
+            return typename column_t::member_t(std::move(value));
+        }
+
         template <ArithmeticT M>
         requires (std::is_convertible_v<M, typename column_t::member_t>)
         ColumnExpression<Table, column_t, comparison_op_t::EQ, M> operator==(M value) {
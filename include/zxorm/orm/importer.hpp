@@ -0,0 +1,561 @@
+/*
+* Copyright (c) 2023 Zach Gerstman
+* https://github.com/crabmandable/zxorm
+* This Source Code Form is subject to the terms of the Mozilla Public
+* License, v. 2.0. If a copy of the MPL was not distributed with this
+* file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*/
+#pragma once
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <deque>
+#include <future>
+#include <istream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "zxorm/common.hpp"
+#include "zxorm/error.hpp"
+#include "zxorm/orm/transaction.hpp"
+
+namespace zxorm {
+    enum class import_format_t {
+        // RFC 4180, with a header naming the columns, unless `has_header` is false
+        csv,
+        // one flat JSON object per line, keyed by column name
+        ndjson,
+    };
+
+    struct import_options_t {
+        import_format_t format = import_format_t::csv;
+        char delimiter = ',';
+        // without a header, the fields of each CSV record are in the order of the table's columns
+        bool has_header = true;
+        // otherwise a field that isn't a column is an error
+        bool ignore_unknown_fields = false;
+        // records are parsed & inserted in batches of this many
+        size_t batch_size = 1000;
+        // batches are parsed by this many threads, while the calling thread inserts them
+        size_t n_parser_threads = 1;
+        // insert with the ids in the file, updating records that conflict with them,
+        // otherwise auto incremented ids are ignored
+        bool upsert = false;
+    };
+
+    struct import_stats_t {
+        size_t rows = 0;
+        size_t batches = 0;
+        std::chrono::nanoseconds duration{0};
+
+        double rows_per_second() const {
+            if (duration.count() == 0) return 0;
+            return static_cast<double>(rows) / std::chrono::duration<double>(duration).count();
+        }
+    };
+
+    namespace __import_detail {
+        struct field_t {
+            std::string value;
+            bool is_null = false;
+        };
+
+        // reads one CSV record, which may span lines if a quoted field contains a line break
+        inline bool read_csv_record(std::istream& in, std::string& record) {
+            record.clear();
+            std::string line;
+            bool any = false;
+            bool in_quotes = false;
+            while (std::getline(in, line)) {
+                if (!line.empty() && line.back() == '\r') {
+                    line.pop_back();
+                }
+                if (any) {
+                    record.push_back('\n');
+                }
+                any = true;
+                record.append(line);
+
+                // an escaped quote toggles twice
+                for (char c : line) {
+                    if (c == '"') in_quotes = !in_quotes;
+                }
+                if (!in_quotes) {
+                    return true;
+                }
+            }
+
+            if (in_quotes) {
+                throw ImportError("Unterminated quoted field");
+            }
+            return any;
+        }
+
+        inline bool read_line(std::istream& in, std::string& line) {
+            if (!std::getline(in, line)) {
+                return false;
+            }
+            if (!line.empty() && line.back() == '\r') {
+                line.pop_back();
+            }
+            return true;
+        }
+
+        inline bool is_blank(std::string_view s) {
+            return s.find_first_not_of(" \t") == std::string_view::npos;
+        }
+
+        /**
+         * split_csv - split a record into `fields`, reusing their storage
+         *
+         * An empty field that isn't quoted is null
+         *
+         * @returns the number of fields
+         */
+        inline size_t split_csv(std::string_view record, char delimiter, std::vector<field_t>& fields) {
+            size_t n = 0;
+            size_t i = 0;
+            while (true) {
+                if (fields.size() <= n) {
+                    fields.emplace_back();
+                }
+                auto& field = fields[n++];
+                field.value.clear();
+                field.is_null = false;
+
+                if (i < record.size() && record[i] == '"') {
+                    i++;
+                    while (true) {
+                        if (i >= record.size()) {
+                            throw ImportError("Unterminated quoted field");
+                        }
+                        char c = record[i++];
+                        if (c != '"') {
+                            field.value.push_back(c);
+                        } else if (i < record.size() && record[i] == '"') {
+                            field.value.push_back('"');
+                            i++;
+                        } else {
+                            break;
+                        }
+                    }
+                    if (i < record.size() && record[i] != delimiter) {
+                        throw ImportError("Unexpected character after a quoted field");
+                    }
+                } else {
+                    size_t end = std::min(record.find(delimiter, i), record.size());
+                    field.value.assign(record.substr(i, end - i));
+                    field.is_null = field.value.empty();
+                    i = end;
+                }
+
+                if (i >= record.size()) {
+                    return n;
+                }
+                i++;
+            }
+        }
+
+        // a parser for a single JSON object, whose values are strings, numbers, booleans or null
+        class json_object_parser {
+            std::string_view _in;
+            size_t _i = 0;
+
+            [[noreturn]] void fail(const char* msg) {
+                throw ImportError(std::string(msg) + " at offset " + std::to_string(_i));
+            }
+
+            void skip_whitespace() {
+                while (_i < _in.size() && (_in[_i] == ' ' || _in[_i] == '\t' || _in[_i] == '\n' || _in[_i] == '\r')) {
+                    _i++;
+                }
+            }
+
+            char peek() {
+                skip_whitespace();
+                if (_i >= _in.size()) {
+                    fail("Unexpected end of JSON");
+                }
+                return _in[_i];
+            }
+
+            void expect(char c) {
+                if (peek() != c) {
+                    fail("Unexpected character in JSON");
+                }
+                _i++;
+            }
+
+            unsigned hex4() {
+                if (_i + 4 > _in.size()) {
+                    fail("Invalid unicode escape in JSON");
+                }
+                unsigned value = 0;
+                auto [end, ec] = std::from_chars(_in.data() + _i, _in.data() + _i + 4, value, 16);
+                if (ec != std::errc{} || end != _in.data() + _i + 4) {
+                    fail("Invalid unicode escape in JSON");
+                }
+                _i += 4;
+                return value;
+            }
+
+            static void append_utf8(std::string& out, unsigned cp) {
+                if (cp < 0x80) {
+                    out.push_back(static_cast<char>(cp));
+                } else if (cp < 0x800) {
+                    out.push_back(static_cast<char>(0xc0 | (cp >> 6)));
+                    out.push_back(static_cast<char>(0x80 | (cp & 0x3f)));
+                } else if (cp < 0x10000) {
+                    out.push_back(static_cast<char>(0xe0 | (cp >> 12)));
+                    out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3f)));
+                    out.push_back(static_cast<char>(0x80 | (cp & 0x3f)));
+                } else {
+                    out.push_back(static_cast<char>(0xf0 | (cp >> 18)));
+                    out.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3f)));
+                    out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3f)));
+                    out.push_back(static_cast<char>(0x80 | (cp & 0x3f)));
+                }
+            }
+
+            void string(std::string& out) {
+                expect('"');
+                out.clear();
+                while (true) {
+                    if (_i >= _in.size()) {
+                        fail("Unterminated string in JSON");
+                    }
+                    char c = _in[_i++];
+                    if (c == '"') {
+                        return;
+                    }
+                    if (c != '\\') {
+                        out.push_back(c);
+                        continue;
+                    }
+                    if (_i >= _in.size()) {
+                        fail("Unterminated string in JSON");
+                    }
+                    switch (char escaped = _in[_i++]) {
+                        case '"': case '\\': case '/': out.push_back(escaped); break;
+                        case 'b': out.push_back('\b'); break;
+                        case 'f': out.push_back('\f'); break;
+                        case 'n': out.push_back('\n'); break;
+                        case 'r': out.push_back('\r'); break;
+                        case 't': out.push_back('\t'); break;
+                        case 'u': {
+                            unsigned cp = hex4();
+                            // a surrogate pair, half of one can't be written as UTF-8
+                            if (cp >= 0xd800 && cp < 0xdc00) {
+                                if (_in.substr(_i, 2) != "\\u") {
+                                    fail("Unpaired surrogate in JSON");
+                                }
+                                _i += 2;
+                                unsigned low = hex4();
+                                if (low < 0xdc00 || low > 0xdfff) {
+                                    fail("Unpaired surrogate in JSON");
+                                }
+                                cp = 0x10000 + ((cp - 0xd800) << 10) + (low - 0xdc00);
+                            } else if (cp >= 0xdc00 && cp <= 0xdfff) {
+                                fail("Unpaired surrogate in JSON");
+                            }
+                            append_utf8(out, cp);
+                            break;
+                        }
+                        default: fail("Invalid escape in JSON");
+                    }
+                }
+            }
+
+            void literal(std::string_view word) {
+                if (_in.substr(_i, word.size()) != word) {
+                    fail("Unexpected character in JSON");
+                }
+                _i += word.size();
+            }
+
+            void value(field_t& field) {
+                field.is_null = false;
+                char c = peek();
+                if (c == '"') {
+                    string(field.value);
+                } else if (c == 'n') {
+                    literal("null");
+                    field.value.clear();
+                    field.is_null = true;
+                } else if (c == 't' || c == 'f') {
+                    field.value = c == 't' ? "true" : "false";
+                    literal(field.value);
+                } else if (c == '-' || (c >= '0' && c <= '9')) {
+                    size_t start = _i;
+                    while (_i < _in.size() && std::string_view("+-.eE0123456789").find(_in[_i]) != std::string_view::npos) {
+                        _i++;
+                    }
+                    field.value.assign(_in.substr(start, _i - start));
+                } else if (c == '{' || c == '[') {
+                    fail("Nested JSON values can't be imported");
+                } else {
+                    fail("Unexpected character in JSON");
+                }
+            }
+
+        public:
+            explicit json_object_parser(std::string_view in) : _in{in} {}
+
+            // calls `on_field(key, field)` for each member of the object
+            template <typename F>
+            void parse(std::string& key, field_t& field, F&& on_field) {
+                expect('{');
+                if (peek() == '}') {
+                    _i++;
+                } else {
+                    while (true) {
+                        string(key);
+                        expect(':');
+                        value(field);
+                        on_field(std::string_view(key), field);
+                        if (peek() == ',') {
+                            _i++;
+                            continue;
+                        }
+                        expect('}');
+                        break;
+                    }
+                }
+                skip_whitespace();
+                if (_i != _in.size()) {
+                    fail("Unexpected characters after the JSON object");
+                }
+            }
+        };
+
+        template <typename M>
+        void parse_value(const field_t& field, M& out) {
+            if constexpr (ignore_qualifiers::is_optional<M>()) {
+                if (field.is_null) {
+                    out = std::nullopt;
+                } else {
+                    parse_value(field, out.emplace());
+                }
+            } else if constexpr (std::is_same_v<M, bool>) {
+                if (field.value == "1" || field.value == "true") {
+                    out = true;
+                } else if (field.value == "0" || field.value == "false") {
+                    out = false;
+                } else {
+                    throw ImportError("Invalid boolean: " + field.value);
+                }
+            } else if constexpr (std::is_arithmetic_v<M>) {
+                const char* end = field.value.data() + field.value.size();
+                auto [ptr, ec] = std::from_chars(field.value.data(), end, out);
+                if (field.is_null || ec != std::errc{} || ptr != end) {
+                    throw ImportError("Invalid number: " + field.value);
+                }
+            } else if constexpr (traits::is_basic_string<M>()) {
+                out.assign(field.value);
+            } else if constexpr (traits::is_vector<M>() && sizeof(typename M::value_type) == 1) {
+                auto data = reinterpret_cast<const typename M::value_type*>(field.value.data());
+                out.assign(data, data + field.value.size());
+            } else {
+                static_assert(sizeof(M) == 0, "This column type can't be imported");
+            }
+        }
+    };
+
+    /**
+     * Importer - streams CSV or NDJSON into the table for `T`, through `insert_many_records`
+     *
+     * Only one batch is held in memory per parser thread. Everything is imported in one
+     * transaction, so a record that can't be parsed or inserted imports nothing.
+     * Fields that are missing leave the member's default value.
+     */
+    template <class Connection, class T>
+    class Importer {
+        using table_t = typename Connection::template table_for_class_t<T>;
+        using field_t = __import_detail::field_t;
+        using setter_t = void (*)(T&, const field_t&);
+
+        static constexpr size_t n_columns = std::tuple_size_v<typename table_t::columns_t>;
+
+        static_assert([]<typename... C>(std::tuple<C...>) {
+            return (!ignore_qualifiers::is_borrowed_view<typename C::member_t>() && ...);
+        }(typename table_t::columns_t{}), "Imported records can't borrow their data");
+
+        template <typename C>
+        static void set_column(T& record, const field_t& field) {
+            try {
+                if constexpr (C::public_column) {
+                    __import_detail::parse_value(field, C::getter(record));
+                } else {
+                    typename C::member_t value{};
+                    __import_detail::parse_value(field, value);
+                    C::setter(record, std::move(value));
+                }
+            } catch (const ImportError& e) {
+                throw ImportError(std::string("column ") + C::name.value + ": " + e.what());
+            }
+        }
+
+        static constexpr auto column_names = []<typename... C>(std::tuple<C...>) {
+            return std::array<std::string_view, n_columns>{ std::string_view(C::name.value)... };
+        }(typename table_t::columns_t{});
+
+        static constexpr auto setters = []<typename... C>(std::tuple<C...>) {
+            return std::array<setter_t, n_columns>{ &set_column<C>... };
+        }(typename table_t::columns_t{});
+
+        // -1 if there isn't a column called `name`
+        static int column_index(std::string_view name, const import_options_t& options) {
+            for (size_t i = 0; i < n_columns; i++) {
+                if (column_names[i] == name) {
+                    return static_cast<int>(i);
+                }
+            }
+            if (!options.ignore_unknown_fields) {
+                throw ImportError("Unknown column: " + std::string(name));
+            }
+            return -1;
+        }
+
+        // `csv_columns` is the column of each CSV field
+        static std::vector<T> parse_batch(
+                const std::vector<std::string>& raw,
+                size_t first_record,
+                const std::vector<int>& csv_columns,
+                const import_options_t& options)
+        {
+            std::vector<T> records(raw.size());
+            std::vector<field_t> fields;
+            std::string key;
+            field_t field;
+
+            for (size_t r = 0; r < raw.size(); r++) {
+                try {
+                    if (options.format == import_format_t::csv) {
+                        size_t n_fields = __import_detail::split_csv(raw[r], options.delimiter, fields);
+                        if (n_fields != csv_columns.size()) {
+                            throw ImportError("Expected " + std::to_string(csv_columns.size()) +
+                                    " fields, found " + std::to_string(n_fields));
+                        }
+                        for (size_t f = 0; f < n_fields; f++) {
+                            if (csv_columns[f] >= 0) {
+                                setters[static_cast<size_t>(csv_columns[f])](records[r], fields[f]);
+                            }
+                        }
+                    } else {
+                        __import_detail::json_object_parser(raw[r]).parse(key, field, [&](std::string_view name, const field_t& value) {
+                            int column = column_index(name, options);
+                            if (column >= 0) {
+                                setters[static_cast<size_t>(column)](records[r], value);
+                            }
+                        });
+                    }
+                } catch (const ImportError& e) {
+                    throw ImportError("Record " + std::to_string(first_record + r + 1) + ": " + e.what());
+                }
+            }
+
+            return records;
+        }
+
+        // reads up to `n` records, skipping blank lines
+        static void read_batch(std::istream& in, std::vector<std::string>& raw, size_t n, const import_options_t& options) {
+            raw.clear();
+            std::string record;
+            while (raw.size() < n) {
+                bool read = options.format == import_format_t::csv
+                    ? __import_detail::read_csv_record(in, record)
+                    : __import_detail::read_line(in, record);
+                if (!read) {
+                    return;
+                }
+                if (!__import_detail::is_blank(record)) {
+                    raw.push_back(std::move(record));
+                }
+            }
+        }
+
+    public:
+        static import_stats_t run(Connection& connection, std::istream& in, const import_options_t& options) {
+            if (options.batch_size == 0) {
+                throw ImportError("The batch size can't be 0");
+            }
+
+            auto start = std::chrono::steady_clock::now();
+            import_stats_t stats;
+
+            std::vector<int> csv_columns;
+            if (options.format == import_format_t::csv) {
+                if (options.has_header) {
+                    std::string header;
+                    std::vector<field_t> fields;
+                    if (__import_detail::read_csv_record(in, header)) {
+                        size_t n_fields = __import_detail::split_csv(header, options.delimiter, fields);
+                        for (size_t f = 0; f < n_fields; f++) {
+                            csv_columns.push_back(column_index(fields[f].value, options));
+                        }
+                    }
+                } else {
+                    for (size_t c = 0; c < n_columns; c++) {
+                        csv_columns.push_back(static_cast<int>(c));
+                    }
+                }
+            }
+
+            auto insert = [&](std::vector<T> records) {
+                if (records.empty()) return;
+                if (options.upsert) {
+                    connection.template upsert_many_records<T>(records);
+                } else {
+                    connection.template insert_many_records<T>(records);
+                }
+                stats.rows += records.size();
+                stats.batches++;
+            };
+
+            auto transaction = connection.begin_transaction(transaction_mode_t::immediate);
+
+            // batches that are being parsed, oldest first, so they are inserted in order
+            std::deque<std::future<std::vector<T>>> parsing;
+            std::vector<std::string> raw;
+            size_t n_read = 0;
+            while (true) {
+                read_batch(in, raw, options.batch_size, options);
+                if (raw.empty()) {
+                    break;
+                }
+
+                size_t first_record = n_read;
+                n_read += raw.size();
+
+                if (options.n_parser_threads <= 1) {
+                    insert(parse_batch(raw, first_record, csv_columns, options));
+                    continue;
+                }
+
+                parsing.push_back(std::async(std::launch::async,
+                    [&csv_columns, &options, first_record, raw = std::move(raw)]() {
+                        return parse_batch(raw, first_record, csv_columns, options);
+                    }));
+                raw = {};
+
+                if (parsing.size() >= options.n_parser_threads) {
+                    insert(parsing.front().get());
+                    parsing.pop_front();
+                }
+            }
+
+            while (!parsing.empty()) {
+                insert(parsing.front().get());
+                parsing.pop_front();
+            }
+
+            transaction.commit();
+            stats.duration = std::chrono::steady_clock::now() - start;
+            return stats;
+        }
+    };
+};
@@ -0,0 +1,106 @@
+/*
+* Copyright (c) 2023 Zach Gerstman
+* https://github.com/crabmandable/zxorm
+* This Source Code Form is subject to the terms of the Mozilla Public
+* License, v. 2.0. If a copy of the MPL was not distributed with this
+* file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*/
+#pragma once
+#include <optional>
+#include <string_view>
+
+namespace zxorm {
+    enum class journal_mode_t {
+        delete_,
+        truncate,
+        persist,
+        memory,
+        wal,
+        off,
+    };
+
+    enum class synchronous_t {
+        off,
+        normal,
+        full,
+        extra,
+    };
+
+    enum class temp_store_t {
+        default_,
+        file,
+        memory,
+    };
+
+    namespace __pragma_enum_to_str {
+        constexpr const char* synchronous_str(synchronous_t mode) {
+            switch(mode) {
+                case synchronous_t::off:
+                    return "OFF";
+                case synchronous_t::normal:
+                    return "NORMAL";
+                case synchronous_t::full:
+                    return "FULL";
+                case synchronous_t::extra:
+                    return "EXTRA";
+            };
+
+            return "OOPS";
+        }
+
+        constexpr const char* temp_store_str(temp_store_t store) {
+            switch(store) {
+                case temp_store_t::default_:
+                    return "DEFAULT";
+                case temp_store_t::file:
+                    return "FILE";
+                case temp_store_t::memory:
+                    return "MEMORY";
+            };
+
+            return "OOPS";
+        }
+
+        constexpr const char* journal_mode_str(journal_mode_t mode) {
+            switch(mode) {
+                case journal_mode_t::delete_:
+                    return "DELETE";
+                case journal_mode_t::truncate:
+                    return "TRUNCATE";
+                case journal_mode_t::persist:
+                    return "PERSIST";
+                case journal_mode_t::memory:
+                    return "MEMORY";
+                case journal_mode_t::wal:
+                    return "WAL";
+                case journal_mode_t::off:
+                    return "OFF";
+            };
+
+            return "OOPS";
+        }
+
+        // sqlite reports the mode in lower case
+        constexpr std::optional<journal_mode_t> journal_mode_from_str(std::string_view str) {
+            for (auto mode : { journal_mode_t::delete_, journal_mode_t::truncate, journal_mode_t::persist,
+                    journal_mode_t::memory, journal_mode_t::wal, journal_mode_t::off }) {
+                std::string_view name = journal_mode_str(mode);
+                if (name.size() != str.size()) {
+                    continue;
+                }
+
+                bool equal = true;
+                for (size_t i = 0; i < name.size(); i++) {
+                    char c = str[i] >= 'a' && str[i] <= 'z' ? str[i] - ('a' - 'A') : str[i];
+                    equal = equal && c == name[i];
+                }
+
+                if (equal) {
+                    return mode;
+                }
+            }
+
+            return std::nullopt;
+        }
+    }
+};
@@ -8,43 +8,74 @@
 #pragma once
 #include "zxorm/common.hpp"
 #include "zxorm/orm/statement.hpp"
+#include "zxorm/orm/statement_cache.hpp"
 #include "zxorm/orm/record_iterator.hpp"
 #include "zxorm/orm/query/clause.hpp"
+#include "zxorm/helpers/static_sql.hpp"
 #include <sqlite3.h>
 
 namespace zxorm {
     template <typename SelectablesTuple, typename Table, typename ColumnClause, typename JoinsTuple=std::tuple<>>
     class BaseQueryBuilder {
+    private:
+        struct query_prefix_writer {
+            template <typename... Join>
+            static constexpr void write_joins(auto& out, std::type_identity<std::tuple<Join...>>) {
+                ((Join::write(out), out << " "), ...);
+            }
+
+            constexpr void operator()(auto& out) const {
+                ColumnClause::write(out);
+                // e.g. `UPDATE` names the table itself
+                if constexpr (not requires { requires ColumnClause::names_table; }) {
+                    out << "FROM `" << Table::name.value << "` ";
+                }
+                write_joins(out, std::type_identity<JoinsTuple>{});
+            }
+        };
+
     protected:
-        const char* _table_name = Table::name.value;
         sqlite3* _handle;
         std::weak_ptr<Logger> _logger;
+        std::weak_ptr<BusyHandler> _busy_handler;
+        std::weak_ptr<StatementCache> _statement_cache;
         std::shared_ptr<BindingClauseBase> _where;
         std::shared_ptr<Statement> _stmt;
 
+        // everything before the `WHERE` clause is known at compile time
+        static constexpr std::string_view query_prefix() {
+            return static_sql_v<query_prefix_writer>.view();
+        }
+
         // TODO: this is werid, think of a better way
-        virtual void serialize_limits(std::ostream& ) {}
+        virtual void serialize_limits(std::string&) {}
 
-        void prepare()
+        std::string query_string()
         {
-            if (!_stmt) {
-                std::stringstream ss;
-                ss << ColumnClause();
-                ss << "FROM `" << _table_name << "` ";
-
-                std::apply([&](const auto&... j) {
-                        ((ss << j << " "), ...);
-                        }, JoinsTuple{});
+            std::string query;
+            query.reserve(query_prefix().size() + (_where ? _where->clause.size() : 0) + 64);
+            query.append(query_prefix());
 
-                if (_where) {
-                    ss << _where->clause << " ";
-                }
+            if (_where) {
+                query.append(_where->clause);
+                query.append(" ");
+            }
 
-                serialize_limits(ss);
+            serialize_limits(query);
 
-                ss << ";";
+            query.append(";");
+            return query;
+        }
 
-                _stmt = std::make_shared<Statement>(_handle, _logger, ss.str());
+        void prepare()
+        {
+            if (!_stmt) {
+                auto cache = _statement_cache.lock();
+                if (cache) {
+                    _stmt = cache->get(query_string());
+                } else {
+                    _stmt = std::make_shared<Statement>(_handle, _logger, _busy_handler, query_string());
+                }
             } else {
                 _stmt->reset();
             }
@@ -54,6 +85,11 @@ namespace zxorm {
             }
         }
 
+        template <typename Bindings>
+        std::shared_ptr<Bindings> where_bindings() {
+            return std::static_pointer_cast<Where<Bindings>>(_where)->bindings;
+        }
+
         template <typename Expression>
         void where(const Expression& e) {
 
@@ -63,7 +99,9 @@ namespace zxorm {
             _where = std::make_shared<Where<decltype(e.bindings())>>(e);
         }
 
-        BaseQueryBuilder(sqlite3* handle, std::weak_ptr<Logger> logger) : _handle(handle), _logger(logger) { }
+        BaseQueryBuilder(sqlite3* handle, std::weak_ptr<Logger> logger, std::weak_ptr<BusyHandler> busy_handler,
+                std::weak_ptr<StatementCache> statement_cache) :
+            _handle(handle), _logger(logger), _busy_handler(busy_handler), _statement_cache(statement_cache) { }
 
         BaseQueryBuilder(BaseQueryBuilder&& old) = default;
         BaseQueryBuilder& operator=(BaseQueryBuilder&& old) = default;
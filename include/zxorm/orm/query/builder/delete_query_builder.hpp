@@ -15,8 +15,12 @@
 namespace zxorm {
     namespace __delete_detail {
         struct DeleteColumnClause {
-            friend std::ostream & operator<< (std::ostream &out, const DeleteColumnClause&) {
+            static constexpr void write(auto& out) {
                 out << "DELETE ";
+            }
+
+            friend std::ostream & operator<< (std::ostream &out, const DeleteColumnClause&) {
+                write(out);
                 return out;
             }
         };
@@ -33,8 +37,9 @@ namespace zxorm {
             __delete_detail::DeleteColumnClause>;
 
     public:
-        DeleteQueryBuilder(sqlite3* handle, std::weak_ptr<Logger> logger) :
-            Super(handle, logger) {}
+        DeleteQueryBuilder(sqlite3* handle, std::weak_ptr<Logger> logger, std::weak_ptr<BusyHandler> busy_handler,
+                std::weak_ptr<StatementCache> statement_cache = {}) :
+            Super(handle, logger, busy_handler, statement_cache) {}
 
         DeleteQueryBuilder(DeleteQueryBuilder&& other) = default;
 
@@ -42,7 +47,8 @@ namespace zxorm {
         auto where(const Expression& e) -> PreparedDelete<decltype(e.bindings())> {
             Super::where(e);
             Super::prepare();
-            return PreparedDelete<decltype(e.bindings())>(Super::_stmt);
+            return PreparedDelete<decltype(e.bindings())>(Super::_stmt,
+                    Super::template where_bindings<decltype(e.bindings())>());
         }
     };
 };
@@ -24,24 +24,28 @@ namespace zxorm {
         std::string _order_clause;
         std::string _group_by_clause;
 
-        virtual void serialize_limits(std::ostream& ss) override {
-            ss << _group_by_clause << " " << _order_clause << " " << _limit_clause;
+        virtual void serialize_limits(std::string& query) override {
+            query.append(_group_by_clause);
+            query.append(" ");
+            query.append(_order_clause);
+            query.append(" ");
+            query.append(_limit_clause);
         }
 
     public:
-        SelectQueryBuilder(sqlite3* handle, std::weak_ptr<Logger> logger) :
-            Super(handle, logger) {}
+        SelectQueryBuilder(sqlite3* handle, std::weak_ptr<Logger> logger, std::weak_ptr<BusyHandler> busy_handler,
+                std::weak_ptr<StatementCache> statement_cache = {}) :
+            Super(handle, logger, busy_handler, statement_cache) {}
 
         SelectQueryBuilder(SelectQueryBuilder&& other) = default;
 
         auto& limit(unsigned long limit, unsigned long offset = 0) {
             if (_limit_clause.empty()) {
-                std::stringstream ss;
-                ss << "LIMIT " << limit;
+                SQLStringWriter out{_limit_clause};
+                out << "LIMIT " << limit;
                 if (offset) {
-                    ss << " OFFSET " << offset;
+                    out << " OFFSET " << offset;
                 }
-                _limit_clause = ss.str();
             }
             return *this;
         }
@@ -56,9 +60,9 @@ namespace zxorm {
                 static_assert(table_is_selectable<table_t, SelectablesTuple>::value,
                         "Field for `order_by` must belong to a table present in the query");
 
-                std::stringstream ss;
-                ss << "ORDER BY `" << table_t::name.value << "`.`" << column_t::name.value << "` " << ord;
-                _order_clause = ss.str();
+                SQLStringWriter out{_order_clause};
+                out << "ORDER BY `" << table_t::name.value << "`.`" << column_t::name.value << "` "
+                    << (ord == order_t::ASC ? "ASC" : "DESC");
             }
             return *this;
         }
@@ -85,9 +89,8 @@ namespace zxorm {
                 }
 
 
-                std::stringstream ss;
-                ss << "GROUP BY `" << table_name << "`.`" << column_name << "`";
-                _group_by_clause = ss.str();
+                SQLStringWriter out{_group_by_clause};
+                out << "GROUP BY `" << table_name << "`.`" << column_name << "`";
             }
             return *this;
         }
@@ -98,7 +101,8 @@ namespace zxorm {
             Super::where(e);
             limit(1);
             Super::prepare();
-            return PreparedSelectOne<Select, decltype(e.bindings())>(Super::_stmt);
+            return PreparedSelectOne<Select, decltype(e.bindings())>(Super::_stmt,
+                    Super::template where_bindings<decltype(e.bindings())>());
         }
 
         template <typename Expression>
@@ -106,7 +110,8 @@ namespace zxorm {
         {
             Super::where(e);
             Super::prepare();
-            return PreparedSelectMany<Select, decltype(e.bindings())>(Super::_stmt);
+            return PreparedSelectMany<Select, decltype(e.bindings())>(Super::_stmt,
+                    Super::template where_bindings<decltype(e.bindings())>());
         }
 
         auto one() -> PreparedSelectOne<Select>
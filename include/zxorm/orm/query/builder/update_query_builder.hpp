@@ -0,0 +1,106 @@
+/*
+* Copyright (c) 2023 Zach Gerstman
+* https://github.com/crabmandable/zxorm
+* This Source Code Form is subject to the terms of the Mozilla Public
+* License, v. 2.0. If a copy of the MPL was not distributed with this
+* file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*/
+#pragma once
+#include <memory>
+#include <sqlite3.h>
+#include "zxorm/common.hpp"
+#include "zxorm/orm/query/builder/base_query_builder.hpp"
+#include "zxorm/orm/query/prepared_query/prepared_update_query.hpp"
+
+namespace zxorm {
+    namespace __update_detail {
+        template <typename Table, typename... Set>
+        struct UpdateColumnClause {
+            static constexpr bool names_table = true;
+
+            static constexpr void write(auto& out) {
+                out << "UPDATE `" << Table::name.value << "` SET ";
+                size_t i = 0;
+                ((out << (i++ ? ", " : ""), Set::write(out)), ...);
+                out << " ";
+            }
+
+            friend std::ostream & operator<< (std::ostream &out, const UpdateColumnClause&) {
+                write(out);
+                return out;
+            }
+        };
+
+        // the `SET` values are bound before the `WHERE` clause,
+        // so they are bound as if they were part of it
+        template <typename Expression, typename... Set>
+        struct SetAndWhere {
+            using tables_t = typename Expression::tables_t;
+
+            const std::tuple<Set...>& set;
+            const Expression& where;
+
+            void serialize(std::string& out) const {
+                where.serialize(out);
+            }
+
+            auto bindings() const {
+                return std::apply([&](const auto&... s) {
+                    return std::tuple_cat(s.bindings()..., where.bindings());
+                }, set);
+            }
+        };
+    };
+
+    template <class Table, typename... Set>
+    class UpdateQueryBuilder : public BaseQueryBuilder<
+                        std::tuple<__selectable_table<false, Table::name>>,
+                        Table,
+                        __update_detail::UpdateColumnClause<Table, Set...>>
+    {
+        using Super = BaseQueryBuilder<
+            std::tuple<__selectable_table<false, Table::name>>,
+            Table,
+            __update_detail::UpdateColumnClause<Table, Set...>>;
+
+        template <class, typename...> friend class UpdateQueryBuilder;
+
+        std::tuple<Set...> _set;
+
+    public:
+        UpdateQueryBuilder(sqlite3* handle, std::weak_ptr<Logger> logger, std::weak_ptr<BusyHandler> busy_handler,
+                std::weak_ptr<StatementCache> statement_cache = {}, std::tuple<Set...> set = {}) :
+            Super(handle, logger, busy_handler, statement_cache), _set{std::move(set)} {}
+
+        UpdateQueryBuilder(UpdateQueryBuilder&& other) = default;
+
+        /**
+         * set - the columns to update, e.g. `Field<T, "name">() = "value"`
+         *
+         * The `SET` clause is written at compile time, so each combination of
+         * fields is a separate statement, and the values are bound to it
+         */
+        template <typename... NewSet>
+        auto set(NewSet... set) -> UpdateQueryBuilder<Table, Set..., NewSet...> {
+            static_assert((std::is_same_v<typename NewSet::table_t, Table> && ...),
+                    "Fields to set should belong to the table being updated");
+
+            return UpdateQueryBuilder<Table, Set..., NewSet...>(
+                    Super::_handle, Super::_logger, Super::_busy_handler, Super::_statement_cache,
+                    std::tuple_cat(std::move(_set), std::tuple<NewSet...>(std::move(set)...)));
+        }
+
+        template <typename Expression>
+        auto where(const Expression& e) {
+            static_assert(sizeof...(Set) > 0, "An update query should set at least one field");
+
+            auto set_and_where = __update_detail::SetAndWhere<Expression, Set...>{_set, e};
+            using bindings_t = decltype(set_and_where.bindings());
+
+            Super::where(set_and_where);
+            Super::prepare();
+            return PreparedUpdate<bindings_t>(Super::_stmt,
+                    Super::template where_bindings<bindings_t>());
+        }
+    };
+};
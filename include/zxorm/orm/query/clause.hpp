@@ -8,6 +8,7 @@
 #pragma once
 #include "zxorm/common.hpp"
 #include "zxorm/orm/statement.hpp"
+#include "zxorm/orm/column_results.hpp"
 
 namespace zxorm {
     // base class so that we can deal with any clause without having to know how it binds
@@ -20,9 +21,11 @@ namespace zxorm {
 
     template <typename Bindings = std::tuple<>>
     struct BindingClause: public BindingClauseBase {
-        Bindings bindings;
+        // shared with the statement & prepared query, so that the bound buffers outlive them
+        std::shared_ptr<Bindings> bindings;
 
-        BindingClause(std::string clause, Bindings bindings) : BindingClauseBase{clause}, bindings{bindings} {}
+        BindingClause(std::string clause, Bindings bindings) :
+            BindingClauseBase{clause}, bindings{std::make_shared<Bindings>(std::move(bindings))} {}
 
         void bind(Statement& s) {
             s.bind(bindings);
@@ -32,7 +35,14 @@ namespace zxorm {
     template <typename Bindings = std::tuple<>>
     struct Where: public BindingClause<Bindings> {
         template <typename Expression>
-        Where(const Expression& e) : BindingClause<Bindings>{std::string("WHERE ") + e.serialize(), e.bindings()} {}
+        Where(const Expression& e) : BindingClause<Bindings>{serialize(e), e.bindings()} {}
+
+        template <typename Expression>
+        static std::string serialize(const Expression& e) {
+            std::string clause = "WHERE ";
+            e.serialize(clause);
+            return clause;
+        }
     };
 
     template<bool _is_optional, typename Table>
@@ -49,6 +59,8 @@ namespace zxorm {
 
         static constexpr size_t n_columns = table::n_columns;
 
+        using column_keys_t = typename __table_column_keys<_is_optional, Table, typename Table::columns_t>::type;
+
         static bool row_is_null(const auto& row) {
             return not Table::primary_key_t::getter(row);
         }
@@ -58,8 +70,22 @@ namespace zxorm {
             return table::get_row(stmt, column_offset);
         }
 
-        friend std::ostream & operator<< (std::ostream &out, const __selection<_is_optional, Table>&) {
+        static void read_row(Statement& stmt, return_t& row, size_t column_offset = 0)
+        {
+            if constexpr (_is_optional) {
+                if (!row) row.emplace();
+                table::read_row(stmt, *row, column_offset);
+            } else {
+                table::read_row(stmt, row, column_offset);
+            }
+        }
+
+        static constexpr void write(auto& out) {
             out << "`" << Table::name.value << "`.*";
+        }
+
+        friend std::ostream & operator<< (std::ostream &out, const __selection<_is_optional, Table>&) {
+            write(out);
             return out;
         }
     };
@@ -79,6 +105,8 @@ namespace zxorm {
 
         static constexpr size_t n_columns = 1;
 
+        using column_keys_t = std::tuple<__column_key<Table, column_t, return_t>>;
+
         // Slightly dubious claim that having a ! operator, and being falsey
         // means the "row" is null
         // its possible this should actually just always return false?
@@ -97,8 +125,17 @@ namespace zxorm {
             return col;
         }
 
-        friend std::ostream & operator<< (std::ostream &out, const __selection<_is_optional, Field<Table, field_name>>&) {
+        static void read_row(Statement& stmt, return_t& row, size_t column_offset = 0)
+        {
+            stmt.read_column(column_offset, row);
+        }
+
+        static constexpr void write(auto& out) {
             out << "`" << Table::name.value << "`.`" << field_name.value << "`";
+        }
+
+        friend std::ostream & operator<< (std::ostream &out, const __selection<_is_optional, Field<Table, field_name>>&) {
+            write(out);
             return out;
         }
     };
@@ -115,6 +152,8 @@ namespace zxorm {
 
         static constexpr size_t n_columns = 1;
 
+        using column_keys_t = std::tuple<__column_key<void, void, return_t>>;
+
         static return_t get_row(Statement& stmt, size_t column_offset = 0)
         {
             return_t count;
@@ -122,12 +161,16 @@ namespace zxorm {
             return count;
         }
 
-        friend std::ostream & operator<< (std::ostream &out, const __count<Field, distinct>&) {
+        static constexpr void write(auto& out) {
             out << "COUNT(";
             if (distinct) {
                 out << "DISTINCT ";
             }
             out << "`" << Field::table_t::name.value << "`.`" << Field::name.value << "`)";
+        }
+
+        friend std::ostream & operator<< (std::ostream &out, const __count<Field, distinct>&) {
+            write(out);
             return out;
         }
     };
@@ -144,6 +187,8 @@ namespace zxorm {
 
         static constexpr size_t n_columns = 1;
 
+        using column_keys_t = std::tuple<__column_key<void, void, return_t>>;
+
         static return_t get_row(Statement& stmt, size_t column_offset = 0)
         {
             return_t count;
@@ -151,8 +196,12 @@ namespace zxorm {
             return count;
         }
 
-        friend std::ostream & operator<< (std::ostream &out, const __count_all&) {
+        static constexpr void write(auto& out) {
             out << "COUNT(*)";
+        }
+
+        friend std::ostream & operator<< (std::ostream &out, const __count_all&) {
+            write(out);
             return out;
         }
     };
@@ -189,16 +238,22 @@ namespace zxorm {
         using return_t = typename _selection_return<Selections...>::type;
         using result_t = std::tuple<std::optional<typename Selections::result_t>...>;
 
-        friend std::ostream & operator<< (std::ostream &out, const __select_impl<From, Selections...>&) {
+        // every column of every selection, in the order they are returned
+        using column_keys_t = decltype(std::tuple_cat(std::declval<typename Selections::column_keys_t>()...));
+
+        static constexpr void write(auto& out) {
             out << "SELECT ";
-                std::apply([&](const auto&... a) {
-                    ([&]() {
-                        out << a << ",";
-                     }(), ...);
-                }, std::tuple<Selections...>{});
-            // erase trailing comma
-            out.seekp(-1, std::ios_base::end);
+            bool first = true;
+            ([&]() {
+                if (!first) out << ",";
+                first = false;
+                Selections::write(out);
+            }(), ...);
             out << " ";
+        }
+
+        friend std::ostream & operator<< (std::ostream &out, const __select_impl<From, Selections...>&) {
+            write(out);
             return out;
         }
     };
@@ -223,24 +278,24 @@ namespace zxorm {
         CROSS,
     };
 
-    static inline std::ostream & operator<< (std::ostream &out, const join_type_t& type) {
+    static inline constexpr const char* join_type_str(join_type_t type) {
         switch (type) {
             case join_type_t::INNER:
-                out << "INNER JOIN ";
-                break;
+                return "INNER JOIN ";
             case join_type_t::LEFT_OUTER:
-                out << "LEFT OUTER JOIN ";
-                break;
+                return "LEFT OUTER JOIN ";
             case join_type_t::RIGHT_OUTER:
-                out << "RIGHT OUTER JOIN ";
-                break;
+                return "RIGHT OUTER JOIN ";
             case join_type_t::FULL_OUTER:
-                out << "FULL OUTER JOIN ";
-                break;
+                return "FULL OUTER JOIN ";
             case join_type_t::CROSS:
-                out << "CROSS JOIN ";
-                break;
+                return "CROSS JOIN ";
         };
+        return "OOPS";
+    };
+
+    static inline std::ostream & operator<< (std::ostream &out, const join_type_t& type) {
+        out << join_type_str(type);
         return out;
     };
 
@@ -330,11 +385,14 @@ namespace zxorm {
             __selectable_table<right_is_optional(type), right_table_name>
         >;
 
-        friend std::ostream & operator<< (std::ostream &out, const __join_impl<TableToJoin, type, AlreadyJoinedTuple>&) {
-            out << type << "`" << TableToJoin::name.value << "`"
+        static constexpr void write(auto& out) {
+            out << join_type_str(type) << "`" << TableToJoin::name.value << "`"
                 << " ON `" << other_table_t::name.value << "`.`" << joined_meta_t::other_column_name() << "`"
                 << " = `" << TableToJoin::name.value << "`.`" << joined_meta_t::column_name() << "`";
+        }
 
+        friend std::ostream & operator<< (std::ostream &out, const __join_impl<TableToJoin, type, AlreadyJoinedTuple>&) {
+            write(out);
             return out;
         }
     };
@@ -378,11 +436,14 @@ namespace zxorm {
             __selectable_table<right_is_optional(type), right_table_name>
         >;
 
-        friend std::ostream & operator<< (std::ostream &out, const __join_on_impl<FieldA, FieldB, type, AlreadyJoinedTuple>&) {
-            out << type << "`" << right_table_name.value << "`"
+        static constexpr void write(auto& out) {
+            out << join_type_str(type) << "`" << right_table_name.value << "`"
                 << " ON `" << left_table_name.value << "`.`" << left_field_name << "`"
                 << " = `" << right_table_name.value << "`.`" << right_field_name << "`";
+        }
 
+        friend std::ostream & operator<< (std::ostream &out, const __join_on_impl<FieldA, FieldB, type, AlreadyJoinedTuple>&) {
+            write(out);
             return out;
         }
     };
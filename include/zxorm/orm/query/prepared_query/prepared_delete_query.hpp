@@ -19,15 +19,16 @@ namespace zxorm {
     template <class Bindings = std::tuple<>>
     class PreparedDelete: public BasePreparedQuery {
         std::shared_ptr<Statement> _stmt;
-        Bindings _bindings;
+        std::shared_ptr<Bindings> _bindings;
     public:
-        PreparedDelete(std::shared_ptr<Statement> stmt) : _stmt(stmt) {}
+        PreparedDelete(std::shared_ptr<Statement> stmt, std::shared_ptr<Bindings> bindings = std::make_shared<Bindings>()) :
+            _stmt(stmt), _bindings(std::move(bindings)) {}
         PreparedDelete(PreparedDelete&&) = default;
 
         void rebind(auto&&... bindings) {
-            _bindings = Bindings{std::forward<decltype(bindings)>(bindings)...};
-
+            // the statement borrows the bindings, so it must be reset before they are overwritten
             _stmt->reset();
+            *_bindings = Bindings{std::forward<decltype(bindings)>(bindings)...};
             _stmt->bind(_bindings);
         }
 
@@ -7,13 +7,17 @@
 */
 #pragma once
 
+#include <limits>
 #include <memory>
 #include <optional>
+#include <span>
 #include <sqlite3.h>
 #include "zxorm/common.hpp"
 #include "zxorm/orm/query/prepared_query/base_prepared_query.hpp"
 #include "zxorm/orm/statement.hpp"
 #include "zxorm/orm/record_iterator.hpp"
+#include "zxorm/orm/borrowed_row.hpp"
+#include "zxorm/orm/column_results.hpp"
 #include "zxorm/orm/table.hpp"
 
 namespace zxorm {
@@ -24,9 +28,18 @@ namespace zxorm {
         BasePreparedSelect(BasePreparedSelect&& old) = default;
     protected:
         std::shared_ptr<Statement> _stmt;
-        Bindings _bindings;
+        std::shared_ptr<Bindings> _bindings;
 
-        BasePreparedSelect(std::shared_ptr<Statement> stmt): _stmt(stmt) {};
+        BasePreparedSelect(std::shared_ptr<Statement> stmt, std::shared_ptr<Bindings> bindings):
+            _stmt(stmt), _bindings(std::move(bindings))
+        {
+            // checked once here, so that reading each row doesn't have to
+            constexpr size_t n_columns = std::tuple_size_v<typename Select::column_keys_t>;
+            if (_stmt->column_count() < static_cast<int>(n_columns)) {
+                throw ConnectionError("Unexpected number of columns returned by query,"
+                        " tables may not be synced");
+            }
+        }
 
         template <typename T, size_t s>
         struct ColumnOffset{
@@ -83,6 +96,12 @@ namespace zxorm {
         using with_offsets_t = typename with_offsets<T>::type;
 
         using return_t = typename Select::return_t;
+
+        // views into sqlite's row buffer are only valid while the statement is on the row
+        static constexpr bool borrows_row = []<typename... Key>(std::tuple<Key...>*) {
+            return (ignore_qualifiers::is_borrowed_view<typename Key::value_t>() || ...);
+        }(static_cast<typename Select::column_keys_t*>(nullptr));
+
         template<size_t record_index, typename T>
         requires (std::tuple_element_t<record_index, typename Select::selections_tuple>::is_optional)
         static auto row_res_to_row (const std::optional<T>& row_res) -> std::optional<T> {
@@ -138,11 +157,36 @@ namespace zxorm {
             }
         }
 
+        // reads into `row`, reusing its storage when a single table or field is selected
+        static void read_row_into(Statement& s, return_t& row)
+        {
+            using selection = std::tuple_element_t<0, typename Select::selections_tuple>;
+            if constexpr (std::tuple_size_v<typename Select::selections_tuple> == 1 &&
+                    requires { selection::read_row(s, row); }) {
+                selection::read_row(s, row);
+            } else {
+                row = read_row(s);
+            }
+        }
+
+        struct row_reader {
+            static constexpr bool borrows_row = BasePreparedSelect::borrows_row;
+
+            static void read_row(Statement& s, return_t& row) {
+                read_row_into(s, row);
+            }
+        };
+
     public:
-        void rebind(auto&&... bindings) {
-            _bindings = Bindings{std::forward<decltype(bindings)>(bindings)...};
+        // ends any read in progress, the next execution starts from the first row
+        void rewind() {
+            _stmt->rewind();
+        }
 
+        void rebind(auto&&... bindings) {
+            // the statement borrows the bindings, so it must be reset before they are overwritten
             _stmt->reset();
+            *_bindings = Bindings{std::forward<decltype(bindings)>(bindings)...};
             _stmt->bind(_bindings);
         }
     };
@@ -151,17 +195,30 @@ namespace zxorm {
     class PreparedSelectOne: public BasePreparedSelect<Select, Bindings> {
         using Super = BasePreparedSelect<Select, Bindings>;
     public:
-        PreparedSelectOne(std::shared_ptr<Statement> stmt): Super(stmt) {};
+        PreparedSelectOne(std::shared_ptr<Statement> stmt, std::shared_ptr<Bindings> bindings = std::make_shared<Bindings>()):
+            Super(stmt, std::move(bindings)) {};
         PreparedSelectOne(PreparedSelectOne&&) = default;
 
-        auto exec() -> std::optional<typename Select::return_t> {
+        // a row of borrowed views keeps the statement on the row until it is dropped
+        using result_t = std::conditional_t<Super::borrows_row,
+              BorrowedRow<typename Select::return_t>,
+              std::optional<typename Select::return_t>>;
+
+        auto exec() -> result_t {
             Super::_stmt->rewind();
             Super::_stmt->step();
             if (Super::_stmt->done()) {
-                return std::nullopt;
+                return result_t{};
             }
 
-            return Super::read_row(*Super::_stmt);
+            auto row = Super::read_row(*Super::_stmt);
+            if constexpr (Super::borrows_row) {
+                return result_t{Super::_stmt, std::move(row)};
+            } else {
+                // a cached statement would otherwise keep the read open until it is next used
+                Super::_stmt->finish();
+                return row;
+            }
         }
     };
 
@@ -170,13 +227,97 @@ namespace zxorm {
         using Super = BasePreparedSelect<Select, Bindings>;
 
     public:
-        PreparedSelectMany(std::shared_ptr<Statement> stmt): Super(stmt) {};
+        PreparedSelectMany(std::shared_ptr<Statement> stmt, std::shared_ptr<Bindings> bindings = std::make_shared<Bindings>()):
+            Super(stmt, std::move(bindings)) {};
         PreparedSelectMany(PreparedSelectMany&&) = default;
 
-        auto exec() -> RecordIterator<typename Select::return_t>
+        using record_iterator_t = RecordIterator<typename Select::return_t, typename Super::row_reader>;
+
+        auto exec() -> record_iterator_t
+        {
+            Super::_stmt->rewind();
+            return record_iterator_t(Super::_stmt);
+        }
+
+        /**
+         * fetch - read up to `rows.size()` more rows into `rows`,
+         *         continuing from the last row that was fetched
+         *
+         * The rows are overwritten in place, so a buffer that is reused
+         * for every batch keeps the capacity of its strings & vectors
+         *
+         * @returns the number of rows fetched, once every row has been fetched
+         *          it returns 0, and the next fetch starts from the first row
+         */
+        size_t fetch(std::span<typename Select::return_t> rows)
         {
+            auto& stmt = *Super::_stmt;
+            if (stmt.done()) {
+                // the last fetch was short, so it already read the final row
+                stmt.rewind();
+                return 0;
+            }
+
+            size_t n_fetched = 0;
+            while (n_fetched < rows.size()) {
+                stmt.step();
+                if (stmt.done()) {
+                    if (n_fetched == 0) {
+                        // the last fetch ended exactly on the final row
+                        stmt.rewind();
+                    }
+                    break;
+                }
+                Super::read_row_into(stmt, rows[n_fetched++]);
+            }
+
+            return n_fetched;
+        }
+
+        using column_results_t = typename __column_results<typename Select::column_keys_t>::type;
+
+        /**
+         * to_columns - read every row of the results into one vector per column
+         */
+        auto to_columns() -> column_results_t
+        {
+            column_results_t columns;
             Super::_stmt->rewind();
-            return RecordIterator<typename Select::return_t>(Super::_stmt, Super::read_row);
+            fetch_columns(columns, std::numeric_limits<size_t>::max());
+            return columns;
+        }
+
+        /**
+         * fetch_columns - append up to `n` more rows to `columns`,
+         *                 continuing from the last row that was fetched
+         *
+         * @returns the number of rows fetched, once every row has been fetched
+         *          it returns 0, and the next fetch starts from the first row
+         */
+        size_t fetch_columns(column_results_t& columns, size_t n)
+        {
+            auto& stmt = *Super::_stmt;
+            if (stmt.done()) {
+                // the last fetch was short, so it already read the final row
+                stmt.rewind();
+                return 0;
+            }
+
+            size_t n_fetched = 0;
+            while (n_fetched < n) {
+                stmt.step();
+                if (stmt.done()) {
+                    if (n_fetched == 0) {
+                        // the last fetch ended exactly on the final row
+                        stmt.rewind();
+                    }
+                    break;
+                }
+                columns.read_row(stmt);
+                n_fetched++;
+            }
+
+            return n_fetched;
         }
     };
 };
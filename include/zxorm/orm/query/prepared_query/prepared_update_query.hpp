@@ -0,0 +1,40 @@
+/*
+* Copyright (c) 2023 Zach Gerstman
+* https://github.com/crabmandable/zxorm
+* This Source Code Form is subject to the terms of the Mozilla Public
+* License, v. 2.0. If a copy of the MPL was not distributed with this
+* file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*/
+#pragma once
+
+
+#include <memory>
+#include <sqlite3.h>
+#include "zxorm/common.hpp"
+#include "zxorm/orm/statement.hpp"
+#include "zxorm/orm/query/prepared_query/base_prepared_query.hpp"
+
+namespace zxorm {
+    template <class Bindings = std::tuple<>>
+    class PreparedUpdate: public BasePreparedQuery {
+        std::shared_ptr<Statement> _stmt;
+        std::shared_ptr<Bindings> _bindings;
+    public:
+        PreparedUpdate(std::shared_ptr<Statement> stmt, std::shared_ptr<Bindings> bindings = std::make_shared<Bindings>()) :
+            _stmt(stmt), _bindings(std::move(bindings)) {}
+        PreparedUpdate(PreparedUpdate&&) = default;
+
+        // the `SET` values come first, followed by the values in the `WHERE` clause
+        void rebind(auto&&... bindings) {
+            // the statement borrows the bindings, so it must be reset before they are overwritten
+            _stmt->reset();
+            *_bindings = Bindings{std::forward<decltype(bindings)>(bindings)...};
+            _stmt->bind(_bindings);
+        }
+
+        void exec() {
+            _stmt->rewind();
+            return _stmt->step();
+        }
+    };
+};
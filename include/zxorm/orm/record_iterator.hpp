@@ -6,73 +6,110 @@
 * file, You can obtain one at https://mozilla.org/MPL/2.0/.
 */
 #pragma once
+#include <cstddef>
 #include <iterator>
 #include <memory>
+#include <vector>
 #include "zxorm/orm/statement.hpp"
 
 namespace zxorm {
-    template <typename return_t>
+    /**
+     * RecordIterator - an input range over the results of a query
+     *
+     * @param return_t  - The type of each row
+     * @param RowReader - A type with a static `read_row(Statement&, return_t&)`,
+     *                    it is known at compile time so that it can be inlined,
+     *                    and a `borrows_row` flag, set when rows hold views into sqlite's row buffer
+     *
+     * The current row is owned by the range, and is overwritten by each step,
+     * so iterators are only valid for as long as the range is alive
+     */
+    template <typename return_t, typename RowReader>
     class RecordIterator
     {
     private:
-        using row_reader_t = std::function<return_t(Statement&)>;
         std::shared_ptr<Statement> _stmt;
-        row_reader_t _row_reader;
+        return_t _current;
+
+        void next() {
+            if (_stmt->done()) {
+                return;
+            }
+            _stmt->step();
+            if (!_stmt->done()) {
+                // the previous row's storage is reused
+                RowReader::read_row(*_stmt, _current);
+            }
+        }
+
     public:
-        RecordIterator(std::shared_ptr<Statement> stmt,  row_reader_t row_reader) :
-            _stmt{std::move(stmt)}, _row_reader{row_reader} { }
+        explicit RecordIterator(std::shared_ptr<Statement> stmt) : _stmt{std::move(stmt)} { }
+
+        RecordIterator(RecordIterator&&) = default;
+        RecordIterator& operator=(RecordIterator&& other) {
+            if (_stmt) {
+                _stmt->finish();
+            }
+            _stmt = std::move(other._stmt);
+            _current = std::move(other._current);
+            return *this;
+        }
+
+        // a range that isn't read to the end still releases its snapshot
+        ~RecordIterator() {
+            if (_stmt) {
+                _stmt->finish();
+            }
+        }
 
         class iterator
         {
         private:
-            Statement* _stmt = nullptr;
-            row_reader_t _row_reader;
-            return_t _current;
+            RecordIterator* _records = nullptr;
         public:
+            using iterator_concept = std::input_iterator_tag;
             using iterator_category = std::input_iterator_tag;
+            using value_type = return_t;
+            using difference_type = std::ptrdiff_t;
 
-            iterator(Statement* stmt, row_reader_t row_reader): _stmt{stmt}, _row_reader{row_reader} {
-                ++(*this);
-            }
             iterator() = default;
+            explicit iterator(RecordIterator* records): _records{records} { }
 
             iterator& operator++() {
-                if (!_stmt || _stmt->done()) {
-                    return *this;
-                }
-                _stmt->step();
-                if (!_stmt->done()) {
-                    _current = _row_reader(*_stmt);
-                }
+                _records->next();
                 return *this;
             }
 
-            return_t& operator*() {
-                return _current;
+            void operator++(int) {
+                ++(*this);
+            }
+
+            return_t& operator*() const {
+                return _records->_current;
             }
-            bool operator==(const iterator& other) const {
-                // nullptr means end
-                if (!_stmt && other._stmt && other._stmt->done()) return true;
-                if (!other._stmt && _stmt && _stmt->done()) return true;
 
-                return _stmt == other._stmt &&
-                    (!_stmt || _stmt->step_count() == other._stmt->step_count());
+            bool operator==(std::default_sentinel_t) const {
+                return !_records || _records->_stmt->done();
             }
-            bool operator!=(const iterator& other) const { return !(*this == other); }
         };
 
         iterator begin() {
             _stmt->rewind();
-            return iterator(_stmt.get(), _row_reader);
+            next();
+            return iterator(this);
         }
-        iterator end() {
-            return iterator();
+
+        std::default_sentinel_t end() {
+            return std::default_sentinel;
         }
 
-        std::vector<return_t> to_vector() {
+        // `expected_size` is reserved up front, if the number of results is known
+        std::vector<return_t> to_vector(size_t expected_size = 0) {
+            static_assert(!RowReader::borrows_row, "Rows of borrowed views are only valid until the next step, so they can't be collected");
             std::vector<return_t> records;
+            records.reserve(expected_size);
             for(auto& result: *this) {
-                records.emplace_back(result);
+                records.push_back(std::move(result));
             }
             return records;
         }
@@ -6,33 +6,87 @@
 * file, You can obtain one at https://mozilla.org/MPL/2.0/.
 */
 #pragma once
+#include <atomic>
 #include <cassert>
+#include <chrono>
 #include <cstring>
 #include <iterator>
 #include <optional>
+#include <string>
 #include <type_traits>
 #include <memory>
-#include <map>
+#include <vector>
 
 #include "zxorm/common.hpp"
 #include "zxorm/error.hpp"
 #include "zxorm/orm/types.hpp"
+#include "zxorm/orm/busy_handler.hpp"
 #include "zxorm/orm/field.hpp"
 #include "zxorm/helpers/meta_container.hpp"
 
 namespace zxorm {
+    enum class binding_storage_t {
+        // sqlite takes its own copy of the buffer
+        copy,
+        // the buffer is guaranteed to outlive every step until it is re-bound
+        borrow,
+    };
+
     class Statement {
         private:
         sqlite3* _handle;
         std::weak_ptr<Logger> _logger;
+        std::weak_ptr<BusyHandler> _busy_handler;
         std::unique_ptr<sqlite3_stmt, std::function<void(sqlite3_stmt*)>> _stmt;
         size_t _parameter_count;
-        std::map<size_t, bool> _is_bound;
-        std::map<size_t, std::vector<uint8_t>> _blob_bindings;
+        std::vector<bool> _is_bound;
+        size_t _n_bound = 0;
+        // keeps borrowed bindings alive for as long as they are bound
+        std::shared_ptr<const void> _bound_storage;
         int _column_count = 0;
         size_t _step_count = 0;
+        // counts every read started, so a borrowed row can tell if the statement has moved on
+        size_t _read_count = 0;
         bool _done = false;
 
+#ifndef NDEBUG
+        // debug builds log statements that hold a read open for longer than this
+        static inline std::atomic<std::chrono::milliseconds::rep> _long_read_threshold = 1000;
+        std::chrono::steady_clock::time_point _read_started;
+#endif
+
+        // runs `run` again while the database is busy, as long as the connection's busy handler allows it
+        static int retry_while_busy(const std::weak_ptr<BusyHandler>& busy_handler, int result,
+                std::chrono::steady_clock::time_point started, auto&& run) {
+            auto handler = (result & 0xff) == SQLITE_BUSY ? busy_handler.lock() : nullptr;
+            return handler ? handler->retry(result, started, run) : result;
+        }
+
+        // called whenever sqlite resets the statement, which releases its read snapshot
+        void end_read() noexcept {
+#ifndef NDEBUG
+            if (_step_count == 0) {
+                return;
+            }
+            auto held = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::steady_clock::now() - _read_started);
+            if (held.count() > _long_read_threshold) {
+                std::string msg = "Statement held a read open for " + std::to_string(held.count()) + "ms: ";
+                msg.append(sqlite3_sql(_stmt.get()));
+                log(_logger, log_level::Error, msg);
+            }
+#endif
+        }
+
+        void mark_bound(size_t idx) {
+            // sqlite has already rejected indexes that are out of range
+            assert(idx <= _parameter_count);
+            if (!_is_bound[idx - 1]) {
+                _is_bound[idx - 1] = true;
+                _n_bound++;
+            }
+        }
+
         static inline void log(const std::weak_ptr<Logger>& logger, log_level level, const std::string_view& msg) {
             auto unwrapped = logger.lock();
             if (unwrapped) {
@@ -41,13 +95,19 @@ namespace zxorm {
         }
 
         public:
-        Statement(sqlite3* handle, std::weak_ptr<Logger> logger, const std::string& query) : _handle{handle}, _logger{logger}
+        Statement(sqlite3* handle, std::weak_ptr<Logger> logger, std::weak_ptr<BusyHandler> busy_handler, std::string_view query) :
+            _handle{handle}, _logger{logger}, _busy_handler{busy_handler}
         {
             log(_logger, log_level::Debug, "Initializing statement");
-            log(_logger, log_level::Debug, query.c_str());
+            log(_logger, log_level::Debug, query);
 
             sqlite3_stmt* stmt = nullptr;
-            int result = sqlite3_prepare_v2(handle, query.c_str(), query.size() + 1, &stmt, nullptr);
+            auto started = std::chrono::steady_clock::now();
+            int result = sqlite3_prepare_v2(handle, query.data(), query.size(), &stmt, nullptr);
+            // preparing may need to read the schema, which can be locked
+            result = retry_while_busy(_busy_handler, result, started, [&]() {
+                return sqlite3_prepare_v2(handle, query.data(), query.size(), &stmt, nullptr);
+            });
             if (result != SQLITE_OK || !stmt) {
                 auto err = SQLExecutionError("Unable to initialize statement", handle);
                 log(_logger, log_level::Error, err);
@@ -63,29 +123,42 @@ namespace zxorm {
             }};
 
             _parameter_count = sqlite3_bind_parameter_count(_stmt.get());
-            for (size_t i = 1; i == _parameter_count; i++) {
-                _is_bound[i] = false;
-            }
+            _is_bound.resize(_parameter_count, false);
+            _column_count = sqlite3_column_count(_stmt.get());
         }
 
-        void bind(auto tuple)
+        void bind(const auto& tuple, binding_storage_t storage = binding_storage_t::copy)
         {
+            // a view in the tuple doesn't own its buffer, so it can't be borrowed
+            auto storage_for = [storage]<typename T>(const T&) {
+                return ignore_qualifiers::is_borrowed_view<T>() ? binding_storage_t::copy : storage;
+            };
+
             size_t i = 1;
             std::apply([&](const auto&... binding) {
                 ([&]() {
                     if constexpr (is_multi_value_binding<std::remove_cvref_t<decltype(binding)>>::value) {
                         for (size_t j = 0; j < binding.size(); j++) {
-                            bind(i++, binding[j]);
+                            bind(i++, binding[j], storage_for(binding[j]));
                         }
                     } else {
-                        bind(i++, binding);
+                        bind(i++, binding, storage_for(binding));
                     }
                 }(), ...);
             }, tuple);
         }
 
+        // Binds a tuple without copying any of its buffers,
+        // the statement shares ownership of the tuple until it is re-bound
+        template <typename Tuple>
+        void bind(std::shared_ptr<Tuple> bindings)
+        {
+            bind(*bindings, binding_storage_t::borrow);
+            _bound_storage = std::move(bindings);
+        }
+
         template <ArithmeticT T>
-        void bind(size_t idx, const T& param)
+        void bind(size_t idx, const T& param, binding_storage_t = binding_storage_t::copy)
         {
             // bindings start at 1 :(
             assert(idx != 0);
@@ -119,11 +192,11 @@ namespace zxorm {
             if (result != SQLITE_OK) {
                 throw InternalError("Unable to bind parameter to statement", _handle);
             }
-            _is_bound[idx] = true;
+            mark_bound(idx);
         }
 
         template <ContinuousContainer T>
-        void bind(size_t idx, const T& param)
+        void bind(size_t idx, const T& param, binding_storage_t storage = binding_storage_t::copy)
         {
             assert(idx != 0);
             bool bound_null = false;
@@ -140,14 +213,17 @@ namespace zxorm {
                 constexpr size_t el_size = sizeof(typename remove_optional<T>::type::value_type);
                 const auto param_to_bind = MetaContainer<const T>(param);
                 auto len = param_to_bind.size() * el_size;
-                _blob_bindings[idx] = std::vector<uint8_t>();
-                _blob_bindings[idx].resize(len);
-                std::memcpy(_blob_bindings[idx].data(), param_to_bind.data(), len);
+
+                // an empty container may not have a buffer,
+                // which sqlite would interpret as NULL
+                const void* data = len ? static_cast<const void*>(param_to_bind.data()) : "";
+
+                auto destructor = storage == binding_storage_t::borrow ? SQLITE_STATIC : SQLITE_TRANSIENT;
 
                 if constexpr (ignore_qualifiers::is_string<T>() || ignore_qualifiers::is_string_view<T>()) {
-                    result = sqlite3_bind_text(_stmt.get(), idx, (char*)_blob_bindings[idx].data(), _blob_bindings[idx].size(), nullptr);
+                    result = sqlite3_bind_text(_stmt.get(), idx, static_cast<const char*>(data), len, destructor);
                 } else {
-                    result = sqlite3_bind_blob(_stmt.get(), idx, _blob_bindings[idx].data(), _blob_bindings[idx].size(), nullptr);
+                    result = sqlite3_bind_blob(_stmt.get(), idx, data, len, destructor);
                 }
             }
 
@@ -155,10 +231,11 @@ namespace zxorm {
                 throw InternalError("Unable to bind parameter to statement", _handle);
             }
 
-            _is_bound[idx] = true;
+            mark_bound(idx);
         }
 
         void rewind() {
+            end_read();
             int result = sqlite3_reset(_stmt.get());
             if (result != SQLITE_OK) {
                 throw InternalError( "Unable to reset statement", _handle);
@@ -174,31 +251,140 @@ namespace zxorm {
             if (result != SQLITE_OK) {
                 throw InternalError( "Unable to clear bindings", _handle);
             }
-            for (auto& [_, v] : _is_bound) v = false;
+            std::fill(_is_bound.begin(), _is_bound.end(), false);
+            _n_bound = 0;
+            _bound_storage = nullptr;
+        }
+
+        // Like `reset`, but for when the statement is no longer being used,
+        // so an error from the last step is not interesting
+        void release() noexcept {
+            end_read();
+            sqlite3_reset(_stmt.get());
+            sqlite3_clear_bindings(_stmt.get());
+            _done = false;
+            _step_count = 0;
+            std::fill(_is_bound.begin(), _is_bound.end(), false);
+            _n_bound = 0;
+            _bound_storage = nullptr;
         }
 
         void step() {
             if (_done) {
                 throw InternalError("Query has run to completion");
             }
-            if (std::any_of(_is_bound.cbegin(), _is_bound.cend(),
-                        [](const auto& bound) { return !bound.second; } )) {
+            if (_n_bound != _parameter_count) {
                 throw InternalError("Some parameters have not been bound");
             }
 
+            // only the first step is run again when busy, and its waits share one deadline
+            std::chrono::steady_clock::time_point started;
+            if (_step_count == 0) {
+                started = std::chrono::steady_clock::now();
+                _read_count++;
+#ifndef NDEBUG
+                _read_started = started;
+#endif
+            }
             int result = sqlite3_step(_stmt.get());
             _step_count++;
+            // a statement that hasn't changed anything can be run again from the start,
+            // this includes transaction control statements, like BEGIN & COMMIT
+            if ((result & 0xff) == SQLITE_BUSY && _step_count == 1 && sqlite3_stmt_readonly(_stmt.get())) [[unlikely]] {
+                result = retry_while_busy(_busy_handler, result, started, [&]() {
+                    sqlite3_reset(_stmt.get());
+                    return sqlite3_step(_stmt.get());
+                });
+            }
             if (result != SQLITE_OK && result != SQLITE_DONE && result != SQLITE_ROW) {
+                // a failed statement is still active until it is reset,
+                // which would stop its transaction from being rolled back
+                auto end_failed_read = [&]() {
+                    end_read();
+                    sqlite3_reset(_stmt.get());
+                    _step_count = 0;
+                };
                 if (is_constraint_error(result)) {
-                    throw SQLConstraintError("Constraint failed", _handle);
+                    auto err = SQLConstraintError("Constraint failed", _handle);
+                    end_failed_read();
+                    throw err;
                 } else {
-                    throw SQLExecutionError("Unable to execute statement", _handle);
+                    auto err = SQLExecutionError("Unable to execute statement", _handle);
+                    end_failed_read();
+                    throw err;
                 }
             }
 
             _done = result == SQLITE_DONE;
+            if (_done) {
+                // the results are exhausted, so the snapshot is released right away,
+                // rather than when the statement is next used
+                end_read();
+                sqlite3_reset(_stmt.get());
+                _step_count = 0;
+            }
+        }
 
-            _column_count = sqlite3_column_count(_stmt.get());
+        /**
+         * finish - end the current read, releasing its snapshot
+         *
+         * The statement is left rewound, so whoever uses it next starts from the first row
+         */
+        void finish() noexcept {
+            if (!_done) {
+                end_read();
+                sqlite3_reset(_stmt.get());
+            }
+            _done = false;
+            _step_count = 0;
+        }
+
+        // in debug builds, reads that are open for longer than `threshold` are logged as errors
+        static void set_long_read_threshold([[maybe_unused]] std::chrono::milliseconds threshold) {
+#ifndef NDEBUG
+            _long_read_threshold = threshold.count();
+#endif
+        }
+
+        // Borrowed reads don't copy, the view points into sqlite's row buffer
+        // and is only valid until the statement is stepped, reset or destroyed
+        template<BorrowedView T>
+        void read_column(size_t idx, T& out_param) {
+            using view_t = typename remove_optional<T>::type;
+            int data_type = sqlite3_column_type(_stmt.get(), idx);
+            switch(data_type) {
+                case SQLITE_INTEGER:
+                case SQLITE_FLOAT: {
+                    throw InternalError("Tried to read an arithmetic column into a container");
+                }
+                case SQLITE_TEXT:
+                case SQLITE_BLOB: {
+                    // the pointer must be fetched before the length, in case sqlite converts the value
+                    if constexpr (ignore_qualifiers::is_string_view<T>()) {
+                        auto data = reinterpret_cast<const char*>(sqlite3_column_text(_stmt.get(), idx));
+                        size_t len = sqlite3_column_bytes(_stmt.get(), idx);
+                        out_param = view_t(data, len);
+                    } else {
+                        auto data = static_cast<const std::byte*>(sqlite3_column_blob(_stmt.get(), idx));
+                        size_t len = sqlite3_column_bytes(_stmt.get(), idx);
+                        out_param = view_t(data, len);
+                    }
+                    break;
+                }
+                case SQLITE_NULL: {
+                    if constexpr (ignore_qualifiers::is_optional<T>()) {
+                        out_param = std::nullopt;
+                    } else {
+                        out_param = view_t{};
+                    }
+                    break;
+                }
+                default: {
+                    // this should never happen :pray:
+                    assert(false);
+                    throw InternalError("Unknown SQL type encountered, something isn't implemented yet");
+                }
+            }
         }
 
         template<ContinuousContainer T>
@@ -275,8 +461,59 @@ namespace zxorm {
             }
         }
 
+        /**
+         * read_known_column - read a column without asking sqlite for the type of the value,
+         *                     for columns that are known to hold a value of type `T`
+         *
+         * A NULL is read as 0, or an empty container.
+         * sqlite doesn't enforce column types, so a value of the wrong type is only
+         * an error in debug builds, in release builds sqlite converts it
+         */
+        template<ArithmeticT T>
+        requires (not ignore_qualifiers::is_optional<T>())
+        void read_known_column(size_t idx, T& out_param) {
+#ifndef NDEBUG
+            int data_type = sqlite3_column_type(_stmt.get(), idx);
+            if (data_type == SQLITE_TEXT || data_type == SQLITE_BLOB) {
+                throw InternalError("Tried to read a text or blob column into an arithmetic type");
+            }
+#endif
+            if constexpr (std::is_floating_point_v<T>) {
+                out_param = static_cast<T>(sqlite3_column_double(_stmt.get(), idx));
+            } else if constexpr (sizeof(T) <= 4) {
+                out_param = static_cast<T>(sqlite3_column_int(_stmt.get(), idx));
+            } else {
+                out_param = static_cast<T>(sqlite3_column_int64(_stmt.get(), idx));
+            }
+        }
+
+        template<ContinuousContainer T>
+        requires (not ignore_qualifiers::is_optional<T>() &&
+                  not ignore_qualifiers::is_borrowed_view<T>() &&
+                  requires (T& t) { t.resize(0); })
+        void read_known_column(size_t idx, T& out_param) {
+#ifndef NDEBUG
+            int data_type = sqlite3_column_type(_stmt.get(), idx);
+            if (data_type == SQLITE_INTEGER || data_type == SQLITE_FLOAT) {
+                throw InternalError("Tried to read an arithmetic column into a container");
+            }
+#endif
+            // the pointer must be fetched before the length, in case sqlite converts the value
+            const void* data = sqlite3_column_blob(_stmt.get(), idx);
+            size_t len = sqlite3_column_bytes(_stmt.get(), idx);
+            out_param.resize(len / sizeof(typename T::value_type));
+            if (len) {
+                std::memcpy(out_param.data(), data, len);
+            }
+        }
+
+        bool column_is_null(size_t idx) {
+            return sqlite3_column_type(_stmt.get(), idx) == SQLITE_NULL;
+        }
+
         int column_count() { return _column_count; }
         bool done() { return _done; }
         bool step_count() { return _step_count; }
+        size_t read_count() const { return _read_count; }
     };
 };
@@ -0,0 +1,130 @@
+/*
+* Copyright (c) 2023 Zach Gerstman
+* https://github.com/crabmandable/zxorm
+* This Source Code Form is subject to the terms of the Mozilla Public
+* License, v. 2.0. If a copy of the MPL was not distributed with this
+* file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*/
+#pragma once
+#include <list>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+
+#include "zxorm/logger.hpp"
+#include "zxorm/orm/statement.hpp"
+
+namespace zxorm {
+    struct statement_cache_stats_t {
+        size_t hits = 0;
+        size_t misses = 0;
+        size_t evictions = 0;
+        size_t size = 0;
+        size_t capacity = 0;
+    };
+
+    /**
+     * StatementCache - LRU cache of prepared statements, keyed by their SQL
+     *
+     * Statements are handed out as leases, a statement is only handed out
+     * again once every lease on it has been released. Releasing a lease resets
+     * the statement, so an idle statement never keeps a read open.
+     */
+    class StatementCache {
+    public:
+        static constexpr size_t default_capacity = 64;
+
+    private:
+        using entry_t = std::pair<std::string, std::shared_ptr<Statement>>;
+
+        sqlite3* _handle;
+        std::weak_ptr<Logger> _logger;
+        std::weak_ptr<BusyHandler> _busy_handler;
+        size_t _capacity;
+        statement_cache_stats_t _stats;
+
+        // most recently used at the front
+        std::list<entry_t> _entries;
+        // keys are views of the query strings owned by `_entries`
+        std::unordered_map<std::string_view, std::list<entry_t>::iterator> _index;
+
+        static std::shared_ptr<Statement> lease(std::shared_ptr<Statement> stmt) {
+            Statement* raw = stmt.get();
+            // the deleter holds a reference, so the statement is "in use" until the lease is gone,
+            // and outlives the lease even if it is evicted in the meantime
+            return std::shared_ptr<Statement>(raw, [owner = std::move(stmt)](Statement*) mutable {
+                owner->release();
+                owner = nullptr;
+            });
+        }
+
+        void evict_to(size_t capacity) {
+            while (_entries.size() > capacity) {
+                _index.erase(_entries.back().first);
+                _entries.pop_back();
+                _stats.evictions++;
+            }
+        }
+
+    public:
+        StatementCache(sqlite3* handle, std::weak_ptr<Logger> logger, std::weak_ptr<BusyHandler> busy_handler,
+                size_t capacity = default_capacity) :
+            _handle{handle}, _logger{std::move(logger)}, _busy_handler{std::move(busy_handler)}, _capacity{capacity} {}
+
+        StatementCache(const StatementCache&) = delete;
+        StatementCache& operator=(const StatementCache&) = delete;
+
+        /**
+         * get - lease a statement for `query`, preparing it only if there is
+         *       no idle statement for the same SQL in the cache
+         */
+        std::shared_ptr<Statement> get(std::string_view query) {
+            auto found = _index.find(query);
+            if (found != _index.end()) {
+                auto& [_, stmt] = *found->second;
+                // only the cache references it, so nothing can be stepping it
+                if (stmt.use_count() == 1) {
+                    _stats.hits++;
+                    _entries.splice(_entries.begin(), _entries, found->second);
+                    return lease(stmt);
+                }
+
+                // the cached statement is busy, so this one isn't cached
+                _stats.misses++;
+                return std::make_shared<Statement>(_handle, _logger, _busy_handler, query);
+            }
+
+            _stats.misses++;
+            auto stmt = std::make_shared<Statement>(_handle, _logger, _busy_handler, query);
+            if (_capacity == 0) {
+                return stmt;
+            }
+
+            evict_to(_capacity - 1);
+            _entries.emplace_front(std::string(query), stmt);
+            _index.emplace(_entries.front().first, _entries.begin());
+
+            return lease(std::move(stmt));
+        }
+
+        void set_capacity(size_t capacity) {
+            _capacity = capacity;
+            evict_to(_capacity);
+        }
+
+        // statements that are currently leased are not finalized until they are released
+        void clear() {
+            _index.clear();
+            _entries.clear();
+        }
+
+        statement_cache_stats_t stats() const {
+            auto stats = _stats;
+            stats.size = _entries.size();
+            stats.capacity = _capacity;
+            return stats;
+        }
+    };
+};
@@ -14,6 +14,7 @@
 #include "zxorm/orm/column.hpp"
 #include "zxorm/orm/field.hpp"
 #include "zxorm/error.hpp"
+#include "zxorm/helpers/static_sql.hpp"
 
 namespace zxorm {
     namespace __foreign_key_detail {
@@ -108,6 +109,28 @@ class Table {
         };
 
         static constexpr int n_columns = std::tuple_size<std::tuple<Column...>>();
+
+        // the read plan: a `NOT NULL` column is assumed to hold the type of its member,
+        // so there is no need to ask sqlite for the type of each value.
+        // sqlite doesn't enforce this, so it is only checked in debug builds
+        template <typename C>
+        static constexpr bool column_type_is_known = C::is_not_null &&
+            requires (Statement& s, typename C::member_t& m) { s.read_known_column(0, m); };
+
+        template <typename C>
+        static void read_column(Statement& stmt, size_t idx, typename C::member_t& value) {
+            if constexpr (column_type_is_known<C>) {
+                stmt.read_known_column(idx, value);
+            } else {
+                stmt.read_column(idx, value);
+            }
+        }
+
+        template <typename C>
+        static constexpr bool has_column = any_of<std::is_same_v<C, Column>...>;
+
+        // the number of values bound for each row of an insert
+        static constexpr int n_insert_columns = (0 + ... + (Column::is_auto_inc_column ? 0 : 1));
         static constexpr bool has_primary_key = any_of<Column::is_primary_key...>;
 
         using primary_key_t = typename find_primary_key<Column...>::type;
@@ -115,6 +138,13 @@ class Table {
         using object_class = T;
         using columns_t = std::tuple<Column...>;
 
+        // the columns that are set by an update, every column except the primary key by default
+        template <typename... UpdatedColumn>
+        using update_columns_t = std::conditional_t<sizeof...(UpdatedColumn) == 0,
+            decltype(std::tuple_cat(std::declval<std::conditional_t<Column::is_primary_key, std::tuple<>, std::tuple<Column>>>()...)),
+            std::tuple<UpdatedColumn...>
+        >;
+
         using foreign_columns_t = __foreign_key_detail::foreign_only_t<Column...>;
 
 
@@ -140,119 +170,280 @@ class Table {
 
         static constexpr auto name = table_name;
 
-        static std::string create_table_query(bool if_not_exist) {
-            std::stringstream query;
-            query << "CREATE TABLE ";
+        static constexpr void write_create_table_query(auto& out, bool if_not_exist) {
+            out << "CREATE TABLE ";
             if (if_not_exist)
-                query << "IF NOT EXISTS ";
-            query << table_name.value << " (\n";
+                out << "IF NOT EXISTS ";
+            out << table_name.value << " (\n";
+
+            bool first = true;
             ([&] {
-                query << '\t' << "`" << Column::name.value << "` "
+                if (!first) out << ",\n";
+                first = false;
+
+                out << "\t" << "`" << Column::name.value << "` "
                     << sql_type_str(Column::sql_column_type);
 
-                auto constraints = Column::constraint_creation_query();
-                if (!constraints.empty()) {
-                    query << " " << constraints;
+                if constexpr (Column::has_constraints) {
+                    out << " ";
+                    Column::write_constraints(out);
                 }
-                query << ",\n";
             }(), ...);
 
-            // remove final comma & endl
-            std::string qstr = query.str();
-            qstr.erase(qstr.end() - 2);
-
-            return qstr + " );\n";
+            out << "\n );\n";
         }
 
-        static std::string insert_query(size_t n_rows = 1) {
-            std::ostringstream ss;
-            ss << "INSERT INTO `" << table_name.value << "` (";
+        // an upsert updates the existing record that conflicts with the primary key, or any unique column
+        static constexpr bool can_upsert = has_primary_key || any_of<Column::is_unique...>;
 
-            // used to tell us when to insert a NULL for the auto increment column
-            bool auto_inc_idx = -1;
+        // the columns, other than the primary key, that an upserted record can conflict with
+        static constexpr bool has_unique_columns = any_of<(Column::is_unique && not Column::is_primary_key)...>;
 
-            std::apply([&]<typename... U>(const U&...) {
-                int i = 0;
-                ([&]() {
-                    if constexpr (U::is_auto_inc_column) {
-                        auto_inc_idx = i;
-                    }
+        static constexpr void write_upsert_clauses(auto& out) {
+            auto write_conflict_clause = [&]<typename ConflictColumn>(std::type_identity<ConflictColumn>) {
+                out << " ON CONFLICT (`" << ConflictColumn::name.value << "`) DO UPDATE SET ";
 
-                    ss << "`" << U::name.value << "`, ";
-                    i++;
+                bool first = true;
+                ([&] {
+                    // the primary key is only "updated" when there is nothing else,
+                    // so that the conflicting row is still returned
+                    if constexpr (not Column::is_primary_key || n_columns == 1) {
+                        if (!first) out << ", ";
+                        first = false;
+                        out << "`" << Column::name.value << "` = excluded.`" << Column::name.value << "`";
+                    }
                 }(), ...);
-            }, columns_t{});
+            };
 
-            std::string str = ss.str();
-            str.erase(str.end() - 2, str.end());
+            ([&] {
+                if constexpr (Column::is_primary_key || Column::is_unique) {
+                    write_conflict_clause(std::type_identity<Column>{});
+                }
+            }(), ...);
+        }
 
-            std::ostringstream ss2;
-            ss2 << ") VALUES ";
+        // `set_rowids` binds the rowid of an insert, so that it is known up front,
+        // an upsert also returns the rowid, and the unique columns its row can be found by,
+        // since an update through a unique column keeps the existing rowid
+        static constexpr void write_insert_query(auto& out, size_t n_rows, bool set_rowids = false, bool upsert = false) {
+            out << "INSERT INTO `" << table_name.value << "` (";
+
+            bool first = true;
+            ([&] {
+                if (!first) out << ", ";
+                first = false;
+                out << "`" << Column::name.value << "`";
+            }(), ...);
+
+            out << ") VALUES ";
 
             for (size_t i = 0; i < n_rows; i++) {
-                std::ostringstream val;
-                val << "(";
-                for (size_t i = 0; i < n_columns; i++) {
-                    // auto inc column gets a null
-                    val << (i == auto_inc_idx ? "NULL" : "?");
-                    // last column needs to close the paren
-                    val << (i == n_columns - 1 ? "), " : ", ");
-                }
+                if (i) out << ", ";
+                out << "(";
+                first = true;
+                ([&] {
+                    if (!first) out << ", ";
+                    first = false;
+                    // auto inc column gets a null, unless the rowid is bound,
+                    // for an upsert 0 means it is a new record
+                    if (Column::is_auto_inc_column) {
+                        out << (upsert ? "NULLIF(?, 0)" : set_rowids ? "?" : "NULL");
+                    } else {
+                        out << "?";
+                    }
+                }(), ...);
+                out << ")";
+            }
+
+            if (upsert) {
+                write_upsert_clauses(out);
+            }
 
-                auto v = val.str();
-                if (i == n_rows - 1) {
-                    v.erase(v.end() - 2, v.end());
+            if constexpr (has_primary_key) {
+                if (upsert && set_rowids) {
+                    out << " RETURNING `" << primary_key_t::name.value << "`";
+                    ([&] {
+                        if constexpr (Column::is_unique && not Column::is_primary_key) {
+                            out << ", `" << Column::name.value << "`";
+                        }
+                    }(), ...);
                 }
-                ss2 << v;
             }
 
-            return str + ss2.str() + ";";
+            out << ";";
         }
 
-        static std::string update_query() {
-            std::ostringstream ss;
-            ss << "UPDATE `" << table_name.value << "` SET ";
-
-            std::apply([&]<typename... U>(const U&...) {
-                ([&]() {
-                    if constexpr (not U::is_primary_key) {
-                        ss << "`" << U::name.value << "` = ?, ";
-                    }
+        template <typename... UpdatedColumn>
+        static constexpr void write_update_query(auto& out) {
+            static_assert((has_column<UpdatedColumn> && ...),
+                    "Updated columns should belong to the table");
+            static_assert((not UpdatedColumn::is_primary_key && ...),
+                    "The primary key can't be updated");
+
+            out << "UPDATE `" << table_name.value << "` SET ";
+
+            bool first = true;
+            [&]<typename... U>(std::type_identity<std::tuple<U...>>) {
+                ([&] {
+                    if (!first) out << ", ";
+                    first = false;
+                    out << "`" << U::name.value << "` = ?";
                 }(), ...);
-            }, columns_t{});
+            }(std::type_identity<update_columns_t<UpdatedColumn...>>{});
+
+            out << " WHERE `" << primary_key_t::name.value << "` = ?;";
+        }
 
-            std::string str = ss.str();
-            str.erase(str.end() - 2, str.end());
+        // the next rowid is one after this, like sqlite chooses it for an auto incremented primary key
+        static constexpr void write_max_rowid_query(auto& out) {
+            out << "SELECT max(`" << primary_key_t::name.value << "`) FROM `" << table_name.value << "`;";
+        }
 
-            return str + " WHERE `" + primary_key_t::name.value + "` = ?;";
+        // the primary keys are bound to the `n_ids` parameters
+        static constexpr void write_delete_query(auto& out, size_t n_ids) {
+            out << "DELETE FROM `" << table_name.value << "` WHERE `" << primary_key_t::name.value << "` IN (";
+            for (size_t i = 0; i < n_ids; i++) {
+                out << (i ? ", ?" : "?");
+            }
+            out << ");";
         }
 
-        static T get_row(Statement& stmt, size_t column_offset = 0)
-        {
-            if (stmt.column_count() - column_offset < n_columns) {
-                throw ConnectionError("Unexpected number of columns returned by query,"
-                        " tables may not be synced");
+    private:
+        template <bool if_not_exist>
+        struct create_table_query_writer {
+            constexpr void operator()(auto& out) const { write_create_table_query(out, if_not_exist); }
+        };
+
+        template <size_t n_rows, bool set_rowids, bool upsert>
+        struct insert_query_writer {
+            constexpr void operator()(auto& out) const { write_insert_query(out, n_rows, set_rowids, upsert); }
+        };
+
+        template <typename... UpdatedColumn>
+        struct update_query_writer {
+            constexpr void operator()(auto& out) const { write_update_query<UpdatedColumn...>(out); }
+        };
+
+        struct max_rowid_query_writer {
+            constexpr void operator()(auto& out) const { write_max_rowid_query(out); }
+        };
+
+        template <bool set_rowids, bool upsert, size_t... n_rows>
+        static std::optional<std::string_view> find_static_insert_query(size_t n, std::index_sequence<n_rows...>);
+
+    public:
+        // queries that are fully determined by the table are generated at compile time
+        template <bool if_not_exist>
+        static constexpr std::string_view static_create_table_query() {
+            return static_sql_v<create_table_query_writer<if_not_exist>>.view();
+        }
+
+        template <size_t n_rows = 1, bool set_rowids = false, bool upsert = false>
+        static constexpr std::string_view static_insert_query() {
+            return static_sql_v<insert_query_writer<n_rows, set_rowids, upsert>>.view();
+        }
+
+        template <size_t n_rows = 1, bool set_rowids = false>
+        static constexpr std::string_view static_upsert_query() {
+            static_assert(can_upsert, "Upserts need a primary key or unique column to conflict with");
+            return static_insert_query<n_rows, set_rowids, true>();
+        }
+
+        static constexpr std::string_view static_max_rowid_query() {
+            static_assert(has_primary_key, "The max rowid needs a primary key");
+            return static_sql_v<max_rowid_query_writer>.view();
+        }
+
+        template <typename... UpdatedColumn>
+        static constexpr std::string_view static_update_query() {
+            return static_sql_v<update_query_writer<UpdatedColumn...>>.view();
+        }
+
+        // batch sizes (1-16, 32 & 64) that have an insert query generated at compile time
+        static constexpr size_t max_static_insert_rows = 16;
+
+        /**
+         * find_static_insert_query - get the compile time query for inserting `n_rows`
+         *                            if there is one, otherwise `std::nullopt`
+         * @param set_rowids - whether the rowids are bound, or returned for an upsert
+         * @param upsert     - whether conflicting records are updated
+         */
+        template <bool set_rowids = false, bool upsert = false>
+        static std::optional<std::string_view> find_static_insert_query(size_t n_rows) {
+            static_assert(not upsert || can_upsert, "Upserts need a primary key or unique column to conflict with");
+            if (n_rows == 32) return static_insert_query<32, set_rowids, upsert>();
+            if (n_rows == 64) return static_insert_query<64, set_rowids, upsert>();
+            return find_static_insert_query<set_rowids, upsert>(n_rows, std::make_index_sequence<max_static_insert_rows>{});
+        }
+
+        static std::string create_table_query(bool if_not_exist) {
+            return std::string(if_not_exist
+                ? static_create_table_query<true>()
+                : static_create_table_query<false>());
+        }
+
+        static std::string insert_query(size_t n_rows = 1) {
+            if (auto query = find_static_insert_query(n_rows)) {
+                return std::string(query.value());
             }
 
+            std::string query;
+            SQLStringWriter out{query};
+            write_insert_query(out, n_rows);
+            return query;
+        }
+
+        static std::string update_query() {
+            return std::string(static_update_query());
+        }
+
+        static std::string delete_query(size_t n_ids) {
+            std::string query;
+            SQLStringWriter out{query};
+            write_delete_query(out, n_ids);
+            return query;
+        }
+
+        static T get_row(Statement& stmt, size_t column_offset = 0)
+        {
             T record;
+            read_row(stmt, record, column_offset);
+            return record;
+        }
+
+        /**
+         * read_row - reads into an existing record, so its strings & buffers can reuse their capacity
+         *
+         * The number of columns returned by the statement should already have been checked
+         */
+        static void read_row(Statement& stmt, T& record, size_t column_offset = 0)
+        {
             size_t column_idx = column_offset;
             std::apply([&]<typename... U>(const U&...) {
                 ([&]() {
                     if constexpr (U::public_column) {
-                        stmt.read_column(column_idx++, U::getter(record));
+                        read_column<U>(stmt, column_idx++, U::getter(record));
                     } else {
                         using value_t = typename U::member_t;
                         value_t value;
-                        stmt.read_column(column_idx++, value);
+                        read_column<U>(stmt, column_idx++, value);
                         U::setter(record, value);
                     }
                 }(), ...);
             }, columns_t{});
-
-            return record;
         }
 };
 
+template <FixedLengthString table_name, class T, class... Column>
+template <bool set_rowids, bool upsert, size_t... n_rows>
+std::optional<std::string_view> Table<table_name, T, Column...>::find_static_insert_query(size_t n, std::index_sequence<n_rows...>)
+{
+    std::optional<std::string_view> query;
+    // the sequence starts at 0, but there is no such thing as inserting 0 rows
+    ((n == n_rows + 1 ? (query = static_insert_query<n_rows + 1, set_rowids, upsert>(), true) : false) || ...);
+    return query;
+}
+
 template <typename T>
 struct is_table : std::false_type {};
 
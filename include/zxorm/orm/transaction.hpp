@@ -0,0 +1,225 @@
+/*
+* Copyright (c) 2023 Zach Gerstman
+* https://github.com/crabmandable/zxorm
+* This Source Code Form is subject to the terms of the Mozilla Public
+* License, v. 2.0. If a copy of the MPL was not distributed with this
+* file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*/
+#pragma once
+#include <sqlite3.h>
+#include <array>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "zxorm/error.hpp"
+#include "zxorm/logger.hpp"
+#include "zxorm/orm/statement.hpp"
+
+namespace zxorm {
+    enum class transaction_mode_t {
+        // the database is locked by the first read or write
+        deferred,
+        // the write lock is taken immediately, so a read can't be upgraded into a deadlock
+        immediate,
+        // like immediate, but readers are also locked out, unless the database is in WAL mode
+        exclusive,
+    };
+
+    /**
+     * TransactionControl - begins & ends the transactions of a connection,
+     *                      using statements that are prepared the first time they are needed,
+     *                      and then kept for the lifetime of the connection
+     *
+     * Transactions that begin while another is open are savepoints,
+     * each level of nesting has its own savepoint
+     */
+    class TransactionControl {
+        struct savepoint_statements {
+            Statement begin;
+            Statement release;
+            Statement rollback_to;
+        };
+
+        sqlite3* _handle;
+        std::weak_ptr<Logger> _logger;
+        std::weak_ptr<BusyHandler> _busy_handler;
+
+        std::array<std::optional<Statement>, 3> _begin;
+        std::optional<Statement> _commit;
+        std::optional<Statement> _rollback;
+        // the savepoint for each level of nesting, a deque never moves its elements
+        std::deque<savepoint_statements> _savepoints;
+
+        // whether each open level is a savepoint, the innermost is at the back
+        std::vector<bool> _levels;
+
+        static constexpr std::array<const char*, 3> begin_queries = {
+            "BEGIN DEFERRED TRANSACTION;",
+            "BEGIN IMMEDIATE TRANSACTION;",
+            "BEGIN EXCLUSIVE TRANSACTION;",
+        };
+
+        static void run(Statement& stmt) {
+            // an error from the last run, e.g. a busy COMMIT, has already been thrown
+            stmt.release();
+            stmt.step();
+        }
+
+        void run(std::optional<Statement>& stmt, const char* query) {
+            if (!stmt) {
+                stmt.emplace(_handle, _logger, _busy_handler, query);
+            }
+            run(*stmt);
+        }
+
+        savepoint_statements& savepoint(size_t level) {
+            while (_savepoints.size() < level) {
+                std::string name = "`zxorm_savepoint_" + std::to_string(_savepoints.size() + 1) + "`";
+                _savepoints.emplace_back(
+                    Statement(_handle, _logger, _busy_handler, "SAVEPOINT " + name + ";"),
+                    Statement(_handle, _logger, _busy_handler, "RELEASE " + name + ";"),
+                    Statement(_handle, _logger, _busy_handler, "ROLLBACK TO " + name + ";")
+                );
+            }
+            return _savepoints[level - 1];
+        }
+
+        void check_innermost(size_t level) {
+            if (level != _levels.size()) {
+                throw InternalError("Transactions must end in the reverse order that they began");
+            }
+        }
+
+    public:
+        TransactionControl(sqlite3* handle, std::weak_ptr<Logger> logger, std::weak_ptr<BusyHandler> busy_handler) :
+            _handle{handle}, _logger{std::move(logger)}, _busy_handler{std::move(busy_handler)} {}
+
+        TransactionControl(const TransactionControl&) = delete;
+        TransactionControl& operator=(const TransactionControl&) = delete;
+
+        // @returns the level of the new transaction, starting at 1
+        size_t begin(transaction_mode_t mode) {
+            // a transaction opened by other means is nested into as well
+            bool is_savepoint = !_levels.empty() || !sqlite3_get_autocommit(_handle);
+            size_t level = _levels.size() + 1;
+
+            if (is_savepoint) {
+                run(savepoint(level).begin);
+            } else {
+                run(_begin[static_cast<size_t>(mode)], begin_queries[static_cast<size_t>(mode)]);
+            }
+
+            _levels.push_back(is_savepoint);
+            return level;
+        }
+
+        void commit(size_t level) {
+            if (level > _levels.size()) {
+                throw InternalError("The transaction has already been rolled back");
+            }
+            check_innermost(level);
+            if (_levels.back()) {
+                run(savepoint(level).release);
+            } else {
+                run(_commit, "COMMIT TRANSACTION;");
+            }
+            _levels.pop_back();
+        }
+
+        void rollback(size_t level) {
+            // already rolled back with a transaction it was nested in
+            if (level > _levels.size()) {
+                return;
+            }
+            check_innermost(level);
+            bool is_savepoint = _levels.back();
+            _levels.pop_back();
+
+            // sqlite rolls back by itself after some errors
+            if (sqlite3_get_autocommit(_handle)) {
+                _levels.clear();
+                return;
+            }
+
+            if (is_savepoint) {
+                auto& statements = savepoint(level);
+                run(statements.rollback_to);
+                run(statements.release);
+            } else {
+                run(_rollback, "ROLLBACK TRANSACTION;");
+            }
+        }
+
+        size_t depth() const { return _levels.size(); }
+
+        // sqlite rolls back by itself after some errors, which ends every level at once
+        bool is_open(size_t level) const {
+            return level <= _levels.size() && !sqlite3_get_autocommit(_handle);
+        }
+    };
+
+    /**
+     * Transaction - a transaction, or a savepoint if a transaction is already open,
+     *               that is rolled back unless it is committed before it is destroyed
+     *
+     * Nested transactions have to end before the transactions they are nested in.
+     */
+    class Transaction {
+        TransactionControl* _control;
+        size_t _level;
+        std::weak_ptr<Logger> _logger;
+
+    public:
+        Transaction(TransactionControl* control, transaction_mode_t mode, std::weak_ptr<Logger> logger = {}) :
+            _control{control}, _level{control->begin(mode)}, _logger{std::move(logger)} {}
+
+        Transaction(Transaction&& other) noexcept :
+            _control{std::exchange(other._control, nullptr)},
+            _level{other._level},
+            _logger{std::move(other._logger)} {}
+
+        Transaction(const Transaction&) = delete;
+        Transaction& operator=(const Transaction&) = delete;
+        Transaction& operator=(Transaction&&) = delete;
+
+        ~Transaction() {
+            if (!_control) {
+                return;
+            }
+            try {
+                rollback();
+            } catch (const Error& err) {
+                if (auto logger = _logger.lock()) {
+                    (*logger)(log_level::Error, err);
+                }
+            }
+        }
+
+        // if the commit fails, the transaction is still open, and can be rolled back
+        void commit() {
+            if (!_control) {
+                throw InternalError("The transaction has already ended");
+            }
+            _control->commit(_level);
+            _control = nullptr;
+        }
+
+        void rollback() {
+            if (!_control) {
+                throw InternalError("The transaction has already ended");
+            }
+            // whether or not it succeeds, the transaction is over
+            std::exchange(_control, nullptr)->rollback(_level);
+        }
+
+        // false once it is committed or rolled back, including when sqlite rolls it back by itself
+        bool is_open() const { return _control && _control->is_open(_level); }
+
+        // 1 for a transaction, more for savepoints nested in it
+        size_t level() const { return _level; }
+    };
+};
@@ -66,7 +66,7 @@ namespace zxorm {
                 } else {
                     return sqlite_column_type::INTEGER;
                 }
-            } else if constexpr (ignore_qualifiers::is_string<T>()) {
+            } else if constexpr (ignore_qualifiers::is_string<T>() || ignore_qualifiers::is_string_view<T>()) {
                 return sqlite_column_type::TEXT;
             } else if constexpr (ignore_qualifiers::is_continuous_container<T>()) {
                 return sqlite_column_type::BLOB;
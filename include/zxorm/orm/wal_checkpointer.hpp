@@ -0,0 +1,244 @@
+/*
+* Copyright (c) 2023 Zach Gerstman
+* https://github.com/crabmandable/zxorm
+* This Source Code Form is subject to the terms of the Mozilla Public
+* License, v. 2.0. If a copy of the MPL was not distributed with this
+* file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*/
+#pragma once
+#include <sqlite3.h>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include "zxorm/error.hpp"
+#include "zxorm/logger.hpp"
+#include "zxorm/orm/statement.hpp"
+
+namespace zxorm {
+    enum class wal_checkpoint_mode_t {
+        passive,
+        full,
+        restart,
+        truncate,
+    };
+
+    struct wal_checkpointer_options_t {
+        std::chrono::milliseconds interval = std::chrono::seconds(1);
+        // a RESTART checkpoint is run when the log holds more bytes than this,
+        // so the next writer starts again from the beginning of the file
+        int64_t restart_threshold = 64 * 1024 * 1024;
+        // a TRUNCATE checkpoint is run when the file on disk is larger than this
+        int64_t truncate_threshold = 256 * 1024 * 1024;
+        // how long a RESTART or TRUNCATE checkpoint waits for readers & writers
+        std::chrono::milliseconds busy_timeout = std::chrono::milliseconds(100);
+    };
+
+    struct wal_checkpoint_stats_t {
+        size_t checkpoints = 0;
+        size_t restarts = 0;
+        size_t truncates = 0;
+        // checkpoints that couldn't finish because of other connections
+        size_t busy = 0;
+        // the log after the last checkpoint
+        int64_t wal_frames = 0;
+        int64_t wal_size = 0;
+        int64_t wal_file_size = 0;
+        std::chrono::nanoseconds last_duration{0};
+        std::chrono::nanoseconds max_duration{0};
+        std::chrono::nanoseconds total_duration{0};
+    };
+
+    /**
+     * WalCheckpointer - checkpoints a WAL database from a background thread,
+     *                   using a connection of its own
+     *
+     * The connections that write should have `wal_autocheckpoint` turned off,
+     * otherwise a commit may still run a checkpoint inline.
+     *
+     * A PASSIVE checkpoint is run every `interval`, which never blocks other connections.
+     * When the log or the file grows past a threshold the checkpoint is escalated,
+     * which waits up to `busy_timeout` for other connections to finish.
+     */
+    class WalCheckpointer {
+    public:
+        // sqlite's default `wal_autocheckpoint`, restored when a checkpointer is stopped
+        static constexpr int default_wal_autocheckpoint = 1000;
+
+    private:
+        struct handle_closer {
+            void operator()(sqlite3* handle) const { sqlite3_close_v2(handle); }
+        };
+
+        // closed even if the constructor throws, when the destructor wouldn't run
+        std::unique_ptr<sqlite3, handle_closer> _handle;
+        std::shared_ptr<Logger> _logger;
+        wal_checkpointer_options_t _options;
+        std::string _wal_file_name;
+        int64_t _page_size = 0;
+
+        // serializes use of `_handle`
+        std::mutex _checkpoint_mutex;
+
+        mutable std::mutex _stats_mutex;
+        wal_checkpoint_stats_t _stats;
+
+        std::mutex _stop_mutex;
+        std::condition_variable _stop_requested;
+        bool _stop = false;
+        std::thread _thread;
+
+        void log(log_level level, const std::string_view& msg) {
+            if (_logger) {
+                (*_logger)(level, msg);
+            }
+        }
+
+        static int sqlite_mode(wal_checkpoint_mode_t mode) {
+            switch (mode) {
+                case wal_checkpoint_mode_t::passive: return SQLITE_CHECKPOINT_PASSIVE;
+                case wal_checkpoint_mode_t::full: return SQLITE_CHECKPOINT_FULL;
+                case wal_checkpoint_mode_t::restart: return SQLITE_CHECKPOINT_RESTART;
+                case wal_checkpoint_mode_t::truncate: return SQLITE_CHECKPOINT_TRUNCATE;
+            }
+            return SQLITE_CHECKPOINT_PASSIVE;
+        }
+
+        int64_t wal_file_size() const {
+            std::error_code ec;
+            auto size = std::filesystem::file_size(_wal_file_name, ec);
+            return ec ? 0 : size;
+        }
+
+        // returns false if other connections stopped the checkpoint from finishing
+        bool run_checkpoint(wal_checkpoint_mode_t mode) {
+            std::lock_guard lock(_checkpoint_mutex);
+
+            int n_log = 0;
+            int n_checkpointed = 0;
+            auto start = std::chrono::steady_clock::now();
+            int result = sqlite3_wal_checkpoint_v2(_handle.get(), nullptr, sqlite_mode(mode), &n_log, &n_checkpointed);
+            auto duration = std::chrono::steady_clock::now() - start;
+
+            if (result != SQLITE_OK && result != SQLITE_BUSY) {
+                auto err = SQLExecutionError("Unable to checkpoint WAL", _handle.get());
+                log(log_level::Error, err);
+                throw err;
+            }
+
+            std::lock_guard stats_lock(_stats_mutex);
+            _stats.checkpoints++;
+            if (mode == wal_checkpoint_mode_t::restart) _stats.restarts++;
+            if (mode == wal_checkpoint_mode_t::truncate) _stats.truncates++;
+            if (result == SQLITE_BUSY) _stats.busy++;
+            _stats.wal_frames = n_log;
+            _stats.wal_size = n_log * _page_size;
+            _stats.wal_file_size = wal_file_size();
+            _stats.last_duration = duration;
+            _stats.max_duration = std::max(_stats.max_duration, _stats.last_duration);
+            _stats.total_duration += duration;
+
+            return result == SQLITE_OK;
+        }
+
+        void tick() {
+            run_checkpoint(wal_checkpoint_mode_t::passive);
+
+            auto stats = this->stats();
+            if (stats.wal_file_size > _options.truncate_threshold) {
+                run_checkpoint(wal_checkpoint_mode_t::truncate);
+            } else if (stats.wal_size > _options.restart_threshold) {
+                run_checkpoint(wal_checkpoint_mode_t::restart);
+            }
+        }
+
+        void run() {
+            std::unique_lock lock(_stop_mutex);
+            while (!_stop_requested.wait_for(lock, _options.interval, [&]() { return _stop; })) {
+                lock.unlock();
+                try {
+                    tick();
+                } catch (const Error&) {
+                    // already logged, the next tick may succeed
+                }
+                lock.lock();
+            }
+        }
+
+    public:
+        WalCheckpointer(const char* file_name, wal_checkpointer_options_t options = {}, Logger logger = nullptr) :
+            _options{options}
+        {
+            if (logger) {
+                _logger = std::make_shared<Logger>(std::move(logger));
+            }
+
+            sqlite3* handle = nullptr;
+            int result = sqlite3_open_v2(file_name, &handle, SQLITE_OPEN_READWRITE, nullptr);
+            // sqlite usually allocates a handle even if it fails to open
+            _handle.reset(handle);
+            if (result != SQLITE_OK || !_handle) {
+                auto err = ConnectionError("Unable to open sqlite connection for checkpoints", _handle.get());
+                log(log_level::Error, err);
+                throw err;
+            }
+
+            sqlite3_busy_timeout(_handle.get(), _options.busy_timeout.count());
+            _wal_file_name = std::string(sqlite3_db_filename(_handle.get(), "main")) + "-wal";
+
+            // reading the journal mode also makes the connection open the WAL,
+            // until then checkpoints would do nothing
+            std::string journal_mode;
+            {
+                Statement stmt(_handle.get(), _logger, {}, "PRAGMA journal_mode;");
+                stmt.step();
+                stmt.read_column(0, journal_mode);
+            }
+            {
+                Statement stmt(_handle.get(), _logger, {}, "PRAGMA page_size;");
+                stmt.step();
+                stmt.read_column(0, _page_size);
+            }
+
+            if (journal_mode != "wal") {
+                auto err = InternalError("The WAL checkpointer requires the WAL journal mode");
+                log(log_level::Error, err);
+                throw err;
+            }
+
+            _thread = std::thread([this]() { run(); });
+        }
+
+        WalCheckpointer(const WalCheckpointer&) = delete;
+        WalCheckpointer& operator=(const WalCheckpointer&) = delete;
+
+        ~WalCheckpointer() {
+            {
+                std::lock_guard lock(_stop_mutex);
+                _stop = true;
+            }
+            _stop_requested.notify_one();
+            _thread.join();
+        }
+
+        /**
+         * checkpoint - run a checkpoint now, on the calling thread
+         * @return false if other connections stopped the checkpoint from finishing
+         */
+        bool checkpoint(wal_checkpoint_mode_t mode = wal_checkpoint_mode_t::passive) {
+            return run_checkpoint(mode);
+        }
+
+        wal_checkpoint_stats_t stats() const {
+            std::lock_guard lock(_stats_mutex);
+            return _stats;
+        }
+
+        const wal_checkpointer_options_t& options() const { return _options; }
+    };
+};
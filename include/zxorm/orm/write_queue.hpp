@@ -0,0 +1,329 @@
+/*
+* Copyright (c) 2023 Zach Gerstman
+* https://github.com/crabmandable/zxorm
+* This Source Code Form is subject to the terms of the Mozilla Public
+* License, v. 2.0. If a copy of the MPL was not distributed with this
+* file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*/
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "zxorm/orm/connection.hpp"
+#include "zxorm/orm/async_result.hpp"
+
+namespace zxorm {
+    struct write_queue_options_t {
+        // the most requests committed by one transaction
+        size_t max_batch_size = 1000;
+        // how long the writer waits for more requests, before committing a batch that isn't full,
+        // 0 commits whatever has been queued while the previous batch was being committed
+        std::chrono::microseconds max_delay{0};
+    };
+
+    struct write_queue_stats_t {
+        size_t requests = 0;
+        // requests that threw, and were rolled back on their own
+        size_t failed = 0;
+        size_t transactions = 0;
+        size_t largest_batch = 0;
+        std::chrono::nanoseconds commit_duration{0};
+
+        double requests_per_transaction() const {
+            return transactions ? double(requests) / transactions : 0;
+        }
+    };
+
+    /**
+     * WriteQueue - a `Connection` owned by a writer thread, which commits the writes
+     *              of many threads together, so they share the cost of each commit
+     *
+     * Requests are pushed onto a lock free queue, and the writer runs everything that has
+     * been queued in one transaction, in the order it was queued. Each request is run in
+     * a savepoint of its own, so a request that throws is rolled back without the others.
+     *
+     * The result of a request is only ready once its transaction has been committed
+     */
+    template <class... Table>
+    class WriteQueue {
+    public:
+        using connection_t = Connection<Table...>;
+
+    private:
+        struct request {
+            // empty for the request that stops the writer
+            std::function<void(connection_t&)> run;
+            // with the error, if the request or its commit failed
+            std::function<void(std::exception_ptr)> complete;
+            request* next = nullptr;
+        };
+
+        write_queue_options_t _options;
+
+        // a stack of the requests that haven't been taken by the writer yet, newest first
+        std::atomic<request*> _head = nullptr;
+
+        mutable std::mutex _stats_mutex;
+        write_queue_stats_t _stats;
+
+        std::thread _thread;
+
+        void run(std::string file_name, ConnectionOptions connection_options, Logger logger, std::promise<void> opened);
+        void enqueue(request* r);
+
+        // takes every queued request, oldest first, without blocking
+        void take(std::vector<std::unique_ptr<request>>& requests);
+
+        // @returns false once the stop request has been run
+        bool commit_batch(connection_t& connection, std::vector<std::unique_ptr<request>>& batch);
+
+    public:
+        WriteQueue(
+            const char* file_name,
+            write_queue_options_t options = {},
+            ConnectionOptions connection_options = {},
+            Logger logger = nullptr);
+
+        // commits everything that is still queued, then closes the connection
+        ~WriteQueue();
+
+        WriteQueue(const WriteQueue&) = delete;
+        WriteQueue& operator=(const WriteQueue&) = delete;
+
+        /**
+         * submit - run `run(connection)` on the writer thread, as part of the next batch
+         *
+         * `run` shouldn't begin or end transactions of its own
+         */
+        template <typename F>
+        auto submit(F&& run) -> AsyncResult<std::invoke_result_t<std::decay_t<F>&, connection_t&>>;
+
+        auto create_tables(bool if_not_exist = true)
+        { return submit([=](connection_t& c) { c.create_tables(if_not_exist); }); }
+
+        // the result is the record, including its rowid once it has been inserted
+        template<class T>
+        auto insert_record(T record)
+        { return submit([record = std::move(record)](connection_t& c) mutable { c.insert_record(record); return record; }); }
+
+        template<class T>
+        auto upsert_record(T record)
+        { return submit([record = std::move(record)](connection_t& c) mutable { c.upsert_record(record); return record; }); }
+
+        template<class T>
+        auto update_record(T record)
+        { return submit([record = std::move(record)](connection_t& c) { c.update_record(record); }); }
+
+        template<class T, typename PrimaryKeyType>
+        auto delete_record(PrimaryKeyType id)
+        { return submit([id = std::move(id)](connection_t& c) { c.template delete_record<T>(id); }); }
+
+        template<class T>
+        auto insert_many_records(std::vector<T> records, size_t max_batch_size = 0)
+        { return submit([=, records = std::move(records)](connection_t& c) { return c.insert_many_records(records, max_batch_size); }); }
+
+        write_queue_stats_t stats() const {
+            std::lock_guard lock(_stats_mutex);
+            return _stats;
+        }
+    };
+
+    template <class... Table>
+    WriteQueue<Table...>::WriteQueue(
+            const char* file_name,
+            write_queue_options_t options,
+            ConnectionOptions connection_options,
+            Logger logger) : _options{options}
+    {
+        if (_options.max_batch_size == 0) {
+            throw InternalError("The batches of a write queue can't be empty");
+        }
+
+        // the connection is opened on the writer, so that it is only ever used by one thread
+        std::promise<void> opened;
+        auto opened_future = opened.get_future();
+        _thread = std::thread([this, file_name = std::string(file_name), connection_options,
+                logger = std::move(logger), opened = std::move(opened)]() mutable {
+            run(std::move(file_name), std::move(connection_options), std::move(logger), std::move(opened));
+        });
+
+        try {
+            opened_future.get();
+        } catch (...) {
+            _thread.join();
+            throw;
+        }
+    }
+
+    template <class... Table>
+    WriteQueue<Table...>::~WriteQueue()
+    {
+        enqueue(new request{});
+        _thread.join();
+    }
+
+    template <class... Table>
+    void WriteQueue<Table...>::enqueue(request* r)
+    {
+        r->next = _head.load(std::memory_order_relaxed);
+        while (!_head.compare_exchange_weak(r->next, r, std::memory_order_release, std::memory_order_relaxed));
+
+        // the writer only waits when the queue is empty
+        if (!r->next) {
+            _head.notify_one();
+        }
+    }
+
+    template <class... Table>
+    void WriteQueue<Table...>::take(std::vector<std::unique_ptr<request>>& requests)
+    {
+        request* head = _head.exchange(nullptr, std::memory_order_acquire);
+
+        // the stack is newest first
+        size_t first = requests.size();
+        for (; head; head = head->next) {
+            requests.emplace_back(head);
+        }
+        std::reverse(requests.begin() + first, requests.end());
+    }
+
+    template <class... Table>
+    void WriteQueue<Table...>::run(std::string file_name, ConnectionOptions connection_options, Logger logger, std::promise<void> opened)
+    {
+        std::optional<connection_t> connection;
+        try {
+            connection.emplace(file_name.c_str(), connection_options,
+                    SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, nullptr, std::move(logger));
+        } catch (...) {
+            opened.set_exception(std::current_exception());
+            return;
+        }
+        opened.set_value();
+
+        std::vector<std::unique_ptr<request>> queued;
+        std::vector<std::unique_ptr<request>> batch;
+        while (true) {
+            if (queued.empty()) {
+                _head.wait(nullptr, std::memory_order_acquire);
+                take(queued);
+
+                // give other threads a chance to join the batch
+                if (_options.max_delay.count() && queued.size() < _options.max_batch_size) {
+                    std::this_thread::sleep_for(_options.max_delay);
+                    take(queued);
+                }
+            }
+
+            size_t batch_size = std::min(queued.size(), _options.max_batch_size);
+            batch.assign(std::make_move_iterator(queued.begin()), std::make_move_iterator(queued.begin() + batch_size));
+            queued.erase(queued.begin(), queued.begin() + batch_size);
+
+            if (!commit_batch(*connection, batch)) {
+                return;
+            }
+            batch.clear();
+        }
+    }
+
+    template <class... Table>
+    bool WriteQueue<Table...>::commit_batch(connection_t& connection, std::vector<std::unique_ptr<request>>& batch)
+    {
+        // nothing can be queued after the stop request
+        bool stopping = !batch.back()->run;
+        if (stopping) {
+            batch.pop_back();
+        }
+        if (batch.empty()) {
+            return !stopping;
+        }
+
+        std::vector<std::exception_ptr> errors(batch.size());
+        std::chrono::nanoseconds commit_duration{0};
+        try {
+            auto transaction = connection.begin_transaction(transaction_mode_t::immediate);
+            for (size_t i = 0; i < batch.size(); i++) {
+                // after some errors sqlite rolls back the whole transaction, anything run after that
+                // would be committed on its own, and then reported as failed when the commit throws
+                if (!transaction.is_open()) {
+                    break;
+                }
+                try {
+                    auto savepoint = connection.begin_transaction();
+                    batch[i]->run(connection);
+                    savepoint.commit();
+                } catch (...) {
+                    errors[i] = std::current_exception();
+                }
+            }
+
+            auto start = std::chrono::steady_clock::now();
+            transaction.commit();
+            commit_duration = std::chrono::steady_clock::now() - start;
+        } catch (...) {
+            // nothing was committed, and the requests after a rollback were never run
+            for (auto& error : errors) {
+                if (!error) {
+                    error = std::current_exception();
+                }
+            }
+        }
+
+        {
+            std::lock_guard lock(_stats_mutex);
+            _stats.requests += batch.size();
+            _stats.failed += std::ranges::count_if(errors, [](const auto& error) { return error != nullptr; });
+            _stats.transactions++;
+            _stats.largest_batch = std::max(_stats.largest_batch, batch.size());
+            _stats.commit_duration += commit_duration;
+        }
+
+        // outside of the transaction, since completing may resume a coroutine
+        for (size_t i = 0; i < batch.size(); i++) {
+            batch[i]->complete(errors[i]);
+        }
+
+        return !stopping;
+    }
+
+    template <class... Table>
+    template <typename F>
+    auto WriteQueue<Table...>::submit(F&& run) -> AsyncResult<std::invoke_result_t<std::decay_t<F>&, connection_t&>>
+    {
+        using result_t = std::invoke_result_t<std::decay_t<F>&, connection_t&>;
+        auto state = std::make_shared<__async_detail::shared_state<result_t>>();
+
+        // held until the transaction is committed
+        auto value = std::make_shared<std::optional<__async_detail::value_t<result_t>>>();
+        auto shared_run = std::make_shared<std::decay_t<F>>(std::forward<F>(run));
+
+        enqueue(new request{
+            .run = [shared_run, value](connection_t& connection) {
+                if constexpr (std::is_void_v<result_t>) {
+                    (*shared_run)(connection);
+                    value->emplace();
+                } else {
+                    value->emplace((*shared_run)(connection));
+                }
+            },
+            .complete = [state, value](std::exception_ptr error) {
+                if (error) {
+                    state->set_error(std::move(error));
+                } else {
+                    state->set_value(std::move(**value));
+                }
+            },
+        });
+
+        return AsyncResult<result_t>(std::move(state));
+    }
+};
@@ -9,5 +9,8 @@
 
 #include "common.hpp"
 #include "orm/connection.hpp"
+#include "orm/async_connection.hpp"
+#include "orm/connection_pool.hpp"
+#include "orm/write_queue.hpp"
 #include "orm/table.hpp"
 #include "orm/constraints.hpp"
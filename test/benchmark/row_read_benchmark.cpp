@@ -0,0 +1,142 @@
+/*
+* Copyright (c) 2023 Zach Gerstman
+* https://github.com/crabmandable/zxorm
+* This Source Code Form is subject to the terms of the Mozilla Public
+* License, v. 2.0. If a copy of the MPL was not distributed with this
+* file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*/
+
+// Compares the per-row overhead of reading results with zxorm against
+// reading them with the sqlite3 API directly
+//
+// usage: zxorm_benchmark [n_rows] [n_iterations]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include "zxorm/zxorm.hpp"
+
+using namespace zxorm;
+
+struct Row {
+    int id = 0;
+    int some_id = 0;
+    double value = 0;
+    std::string text;
+    std::optional<int> maybe;
+};
+
+using row_table_t = Table<"rows", Row,
+    Column<"id", &Row::id, PrimaryKey<>>,
+    Column<"some_id", &Row::some_id>,
+    Column<"value", &Row::value>,
+    Column<"text", &Row::text, NotNull<>>,
+    Column<"maybe", &Row::maybe>
+>;
+
+using connection_t = Connection<row_table_t>;
+
+static constexpr const char* file_name = "zxorm_benchmark.db";
+
+template <typename F>
+static double ns_per_row(size_t n_rows, size_t n_iterations, F&& run) {
+    size_t checksum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < n_iterations; i++) {
+        checksum += run();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    if (checksum != n_rows * n_iterations) {
+        std::fprintf(stderr, "expected %zu rows, read %zu\n", n_rows * n_iterations, checksum);
+        std::exit(1);
+    }
+
+    return std::chrono::duration<double, std::nano>(elapsed).count() / (n_rows * n_iterations);
+}
+
+static size_t read_raw(sqlite3* db) {
+    sqlite3_stmt* stmt = nullptr;
+    sqlite3_prepare_v2(db, "SELECT `id`, `some_id`, `value`, `text`, `maybe` FROM `rows`;", -1, &stmt, nullptr);
+
+    Row row;
+    size_t n = 0;
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        row.id = sqlite3_column_int(stmt, 0);
+        row.some_id = sqlite3_column_int(stmt, 1);
+        row.value = sqlite3_column_double(stmt, 2);
+        auto text = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 3));
+        row.text.assign(text, sqlite3_column_bytes(stmt, 3));
+        if (sqlite3_column_type(stmt, 4) == SQLITE_NULL) {
+            row.maybe = std::nullopt;
+        } else {
+            row.maybe = sqlite3_column_int(stmt, 4);
+        }
+        n++;
+    }
+
+    sqlite3_finalize(stmt);
+    return n;
+}
+
+int main(int argc, char** argv) {
+    size_t n_rows = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100000;
+    size_t n_iterations = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 20;
+
+    std::remove(file_name);
+    {
+        connection_t connection(file_name);
+        connection.create_tables();
+
+        std::vector<Row> rows(n_rows);
+        for (size_t i = 0; i < n_rows; i++) {
+            rows[i].some_id = i;
+            rows[i].value = i * 0.5;
+            rows[i].text = "row number " + std::to_string(i);
+            if (i % 2) rows[i].maybe = i;
+        }
+        connection.insert_many_records(rows);
+
+        sqlite3* raw = nullptr;
+        sqlite3_open_v2(file_name, &raw, SQLITE_OPEN_READONLY, nullptr);
+
+        double raw_ns = ns_per_row(n_rows, n_iterations, [&]() { return read_raw(raw); });
+
+        auto query = connection.select_query<Row>().many();
+        double iterator_ns = ns_per_row(n_rows, n_iterations, [&]() {
+            size_t n = 0;
+            for (const Row& row : query.exec()) {
+                n += row.id != 0;
+            }
+            return n;
+        });
+
+        // fetching continues from where the last fetch stopped, so it gets its own query
+        auto fetch_query = connection.select_query<Row>().many();
+        std::vector<Row> batch(256);
+        double fetch_ns = ns_per_row(n_rows, n_iterations, [&]() {
+            size_t n = 0;
+            while (size_t fetched = fetch_query.fetch(batch)) {
+                n += fetched;
+            }
+            return n;
+        });
+
+        double columns_ns = ns_per_row(n_rows, n_iterations, [&]() {
+            return query.to_columns().size();
+        });
+
+        sqlite3_close_v2(raw);
+
+        std::printf("rows: %zu, iterations: %zu\n", n_rows, n_iterations);
+        std::printf("%-16s %8.1f ns/row\n", "raw sqlite3", raw_ns);
+        std::printf("%-16s %8.1f ns/row (%+.1f)\n", "RecordIterator", iterator_ns, iterator_ns - raw_ns);
+        std::printf("%-16s %8.1f ns/row (%+.1f)\n", "fetch", fetch_ns, fetch_ns - raw_ns);
+        std::printf("%-16s %8.1f ns/row (%+.1f)\n", "to_columns", columns_ns, columns_ns - raw_ns);
+    }
+    std::remove(file_name);
+
+    return 0;
+}
@@ -0,0 +1,188 @@
+#include <gtest/gtest.h>
+#include <coroutine>
+#include <filesystem>
+#include <future>
+#include <stdexcept>
+#include "zxorm/zxorm.hpp"
+#include "logger.hpp"
+
+using namespace zxorm;
+
+struct AsyncObject {
+    int id = 0;
+    std::string text;
+};
+
+using async_table_t = Table<"async", AsyncObject,
+    Column<"id", &AsyncObject::id, PrimaryKey<>>,
+    Column<"text", &AsyncObject::text>
+>;
+
+using async_connection_t = AsyncConnection<async_table_t>;
+
+// the smallest coroutine type that runs eagerly, enough to `co_await` results
+struct detached_task {
+    struct promise_type {
+        detached_task get_return_object() { return {}; }
+        std::suspend_never initial_suspend() { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+// the parameters are copied into the coroutine frame, unlike a lambda's captures
+static detached_task insert_and_find(async_connection_t& conn, std::optional<AsyncObject>& found, std::atomic<bool>& done)
+{
+    // gcc 12 destroys temporaries in a `co_await` expression twice, so the record is named
+    AsyncObject record{ .text = "awaited" };
+    auto inserted = co_await conn.insert_record(record);
+    found = co_await conn.find_record<AsyncObject>(inserted.id);
+    done = true;
+}
+
+class AsyncConnectionTest : public ::testing::Test {
+    protected:
+    void SetUp() override {
+        my_conn = std::make_shared<async_connection_t>("test.db", 0, nullptr, &logger);
+        my_conn->create_tables().get();
+    }
+
+    std::shared_ptr<async_connection_t> my_conn;
+
+    void TearDown() override {
+        my_conn = nullptr;
+        std::filesystem::remove("test.db");
+    }
+};
+
+TEST_F(AsyncConnectionTest, InsertAndFind)
+{
+    auto inserted = my_conn->insert_record(AsyncObject{ .text = "hello" }).get();
+    ASSERT_EQ(inserted.id, 1);
+
+    auto found = my_conn->find_record<AsyncObject>(1).get();
+    ASSERT_TRUE(found.has_value());
+    ASSERT_EQ(found->text, "hello");
+}
+
+TEST_F(AsyncConnectionTest, RequestsRunInOrder)
+{
+    std::vector<AsyncResult<AsyncObject>> inserts;
+    for (int i = 0; i < 100; i++) {
+        inserts.push_back(my_conn->insert_record(AsyncObject{ .text = std::to_string(i) }));
+    }
+
+    auto all = my_conn->exec_query([](auto& c) {
+        return c.template select_query<AsyncObject>().many();
+    });
+
+    for (size_t i = 0; i < 100; i++) {
+        ASSERT_EQ(inserts[i].get().id, static_cast<int>(i + 1));
+    }
+
+    auto rows = all.get();
+    ASSERT_EQ(rows.size(), 100);
+    ASSERT_EQ(rows.back().text, "99");
+}
+
+TEST_F(AsyncConnectionTest, ErrorsAreRethrown)
+{
+    auto result = my_conn->submit([](auto& c) {
+        c.template update_record(AsyncObject{});
+    });
+
+    ASSERT_THROW(result.get(), InternalError);
+
+    // the executor keeps going
+    ASSERT_EQ(my_conn->insert_record(AsyncObject{}).get().id, 1);
+}
+
+TEST_F(AsyncConnectionTest, BatchesShareATransaction)
+{
+    // holds up the executor, so the next requests are all in one batch
+    std::promise<void> release;
+    auto blocker = my_conn->submit([waiting = release.get_future().share()](auto&) { waiting.wait(); });
+
+    // the batch's transaction, and the request's savepoint, are already open
+    auto nested_level = [](auto& c) { return c.begin_transaction().level(); };
+    auto first = my_conn->submit(nested_level);
+    auto failed = my_conn->submit([](auto& c) {
+        c.insert_record(AsyncObject{ .text = "rolled back" });
+        throw std::runtime_error("oops");
+    });
+    auto inserted = my_conn->insert_record(AsyncObject{ .text = "committed" });
+    release.set_value();
+    blocker.get();
+
+    ASSERT_EQ(first.get(), 3);
+    ASSERT_THROW(failed.get(), std::runtime_error);
+    ASSERT_EQ(inserted.get().id, 1);
+    ASSERT_EQ(my_conn->find_record<AsyncObject>(1).get()->text, "committed");
+}
+
+TEST_F(AsyncConnectionTest, BatchesThatWriteTakeTheWriteLock)
+{
+    my_conn->insert_record(AsyncObject{ .text = "hello" }).get();
+
+    // another connection holds the write lock, so an immediate transaction can't begin
+    Connection<async_table_t> other("test.db");
+    auto lock = other.begin_transaction(transaction_mode_t::immediate);
+
+    // only reads, so the batch can still run
+    {
+        // the blocker may write, so it must be running on its own before the batch is queued
+        std::promise<void> started, release;
+        auto blocker = my_conn->submit([&started, waiting = release.get_future().share()](auto&) {
+            started.set_value();
+            waiting.wait();
+        });
+        started.get_future().wait();
+        auto found = my_conn->find_record<AsyncObject>(1);
+        auto all = my_conn->exec_query([](auto& c) {
+            return c.template select_query<AsyncObject>().many();
+        });
+        release.set_value();
+        blocker.get();
+
+        ASSERT_EQ(found.get()->text, "hello");
+        ASSERT_EQ(all.get().size(), 1);
+    }
+
+    // the write lock is taken before anything in the batch runs, so even the read fails
+    {
+        // the blocker may write, so it must be running on its own before the batch is queued
+        std::promise<void> started, release;
+        auto blocker = my_conn->submit([&started, waiting = release.get_future().share()](auto&) {
+            started.set_value();
+            waiting.wait();
+        });
+        started.get_future().wait();
+        auto found = my_conn->find_record<AsyncObject>(1);
+        auto inserted = my_conn->insert_record(AsyncObject{});
+        release.set_value();
+        blocker.get();
+
+        ASSERT_THROW(found.get(), SQLExecutionError);
+        ASSERT_THROW(inserted.get(), SQLExecutionError);
+    }
+
+    lock.commit();
+    ASSERT_EQ(my_conn->insert_record(AsyncObject{}).get().id, 2);
+}
+
+TEST_F(AsyncConnectionTest, CoAwait)
+{
+    std::atomic<bool> done = false;
+    std::optional<AsyncObject> found;
+
+    insert_and_find(*my_conn, found, done);
+
+    // a round trip through the executor, after which the coroutine has finished
+    while (!done) {
+        my_conn->submit([](auto&) {}).wait();
+    }
+
+    ASSERT_TRUE(found.has_value());
+    ASSERT_EQ(found->text, "awaited");
+}
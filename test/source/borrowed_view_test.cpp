@@ -0,0 +1,120 @@
+#include <gtest/gtest.h>
+#include <filesystem>
+#include "zxorm/zxorm.hpp"
+#include "logger.hpp"
+
+using namespace zxorm;
+
+struct LogLine {
+    int id = 0;
+    std::string_view message;
+    std::span<const std::byte> payload;
+    std::optional<std::string_view> note;
+};
+
+using log_table_t = Table<"log_lines", LogLine,
+    Column<"id", &LogLine::id, PrimaryKey<>>,
+    Column<"message", &LogLine::message>,
+    Column<"payload", &LogLine::payload>,
+    Column<"note", &LogLine::note>
+        >;
+
+using connection_t = Connection<log_table_t>;
+
+class BorrowedViewTest : public ::testing::Test {
+    protected:
+    void SetUp() override {
+        my_conn = std::make_shared<connection_t>("test.db", 0, nullptr, &logger);
+        my_conn->create_tables(true);
+
+        for (size_t i = 0; i < 3; i++) {
+            messages.push_back(std::string("message ") + std::to_string(i));
+            payloads.push_back(std::vector<std::byte>(1024 * (i + 1), std::byte(i)));
+        }
+
+        for (size_t i = 0; i < 3; i++) {
+            LogLine line;
+            line.message = messages[i];
+            line.payload = payloads[i];
+            if (i == 1) line.note = "noted";
+            my_conn->insert_record(line);
+        }
+    }
+
+    std::vector<std::string> messages;
+    std::vector<std::vector<std::byte>> payloads;
+    std::shared_ptr<connection_t> my_conn;
+
+    void TearDown() override {
+        my_conn = nullptr;
+        std::filesystem::rename("test.db", "test.db.old");
+    }
+};
+
+TEST_F(BorrowedViewTest, ColumnTypes)
+{
+    static_assert(log_table_t::column_by_name<"message">::type::sql_column_type == sqlite_column_type::TEXT);
+    static_assert(log_table_t::column_by_name<"payload">::type::sql_column_type == sqlite_column_type::BLOB);
+}
+
+TEST_F(BorrowedViewTest, ReadRecordsWithoutCopying)
+{
+    auto results = my_conn->select_query<LogLine>()
+        .order_by<log_table_t::field_t<"id">>().many().exec();
+
+    size_t i = 0;
+    for (const auto& line : results) {
+        ASSERT_EQ(line.message, messages[i]);
+        ASSERT_EQ(line.payload.size(), payloads[i].size());
+        ASSERT_TRUE(std::equal(line.payload.begin(), line.payload.end(), payloads[i].begin()));
+        if (i == 1) {
+            ASSERT_TRUE(line.note.has_value());
+            ASSERT_EQ(line.note.value(), "noted");
+        } else {
+            ASSERT_FALSE(line.note.has_value());
+        }
+        i++;
+    }
+    ASSERT_EQ(i, 3);
+}
+
+TEST_F(BorrowedViewTest, ReadProjectedField)
+{
+    auto results = my_conn->select_query<log_table_t::field_t<"message">>()
+        .where_many(log_table_t::field_t<"message">().like("%2")).exec();
+
+    size_t n = 0;
+    for (std::string_view message : results) {
+        ASSERT_EQ(message, "message 2");
+        n++;
+    }
+    ASSERT_EQ(n, 1);
+}
+
+TEST_F(BorrowedViewTest, FoundRowReleasesItsSnapshot)
+{
+    my_conn->set_journal_mode(journal_mode_t::wal);
+    LogLine line;
+    line.message = messages[0];
+    my_conn->insert_record(line);
+
+    // a checkpoint that has to wait for readers fails, instead of waiting, if any are still reading
+    WalCheckpointer checkpointer("test.db", {
+        .interval = std::chrono::hours(1),
+        .busy_timeout = std::chrono::milliseconds(0),
+    });
+
+    {
+        auto found = my_conn->find_record<LogLine>(2);
+        ASSERT_TRUE(found);
+        ASSERT_EQ(found->message, messages[1]);
+        ASSERT_EQ(found->note.value(), "noted");
+        ASSERT_FALSE(checkpointer.checkpoint(wal_checkpoint_mode_t::truncate));
+
+        // the row is still valid after the checkpoint has given up
+        ASSERT_EQ(found->message, messages[1]);
+    }
+
+    ASSERT_TRUE(checkpointer.checkpoint(wal_checkpoint_mode_t::truncate));
+    ASSERT_FALSE(my_conn->find_record<LogLine>(100));
+}
@@ -0,0 +1,117 @@
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <thread>
+#include "zxorm/zxorm.hpp"
+#include "logger.hpp"
+
+using namespace zxorm;
+
+struct Lockable {
+    int id = 0;
+};
+
+using lockable_table_t = Table<"lockable", Lockable,
+    Column<"id", &Lockable::id, PrimaryKey<>>
+>;
+
+using busy_connection_t = Connection<lockable_table_t>;
+
+class BusyHandlerTest : public ::testing::Test {
+    protected:
+    void SetUp() override {
+        holder = std::make_shared<busy_connection_t>("test.db", 0, nullptr, &logger);
+        holder->create_tables();
+        holder->insert_record(Lockable{});
+    }
+
+    std::shared_ptr<busy_connection_t> holder;
+
+    void TearDown() override {
+        holder = nullptr;
+        std::filesystem::remove("test.db");
+    }
+};
+
+TEST_F(BusyHandlerTest, WaitsForTheLock)
+{
+    ConnectionOptions options = {
+        .busy_strategy = busy_strategy_t{ .max_wait = std::chrono::milliseconds(50) },
+    };
+    busy_connection_t waiter("test.db", options, 0, nullptr, &logger);
+
+    auto transaction = holder->begin_transaction(transaction_mode_t::immediate);
+
+    auto start = std::chrono::steady_clock::now();
+    ASSERT_THROW(auto _ = waiter.begin_transaction(transaction_mode_t::immediate), SQLExecutionError);
+    ASSERT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(50));
+
+    auto stats = waiter.busy_stats();
+    ASSERT_GE(stats.busy_events, 1);
+    ASSERT_GT(stats.waits, 0);
+    ASSERT_GE(stats.timeouts, 1);
+    ASSERT_GT(stats.time_waiting.count(), 0);
+
+    // released while the waiter is waiting
+    waiter.set_busy_strategy({ .max_wait = std::chrono::seconds(10) });
+    std::thread releaser([&]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        transaction.commit();
+    });
+    auto waited = waiter.begin_transaction(transaction_mode_t::immediate);
+    waiter.insert_record(Lockable{});
+    waited.commit();
+    releaser.join();
+
+    ASSERT_EQ(waiter.busy_stats().timeouts, 0);
+    ASSERT_EQ(waiter.select_query<Count<lockable_table_t>>().one().exec(), 2);
+}
+
+TEST_F(BusyHandlerTest, RetriesShareTheMaxWait)
+{
+    busy_connection_t reader("test.db", 0, nullptr, &logger);
+    reader.set_busy_strategy({
+        .initial_backoff = std::chrono::milliseconds(20),
+        .max_backoff = std::chrono::milliseconds(20),
+        .max_wait = std::chrono::milliseconds(100),
+        .max_retries = 5,
+    });
+
+    // an exclusive lock keeps readers out of a database that isn't in WAL mode
+    auto transaction = holder->begin_transaction(transaction_mode_t::exclusive);
+
+    // the handler waits out the whole budget, so the read isn't run again
+    auto start = std::chrono::steady_clock::now();
+    ASSERT_THROW(std::ignore = reader.find_record<Lockable>(1), SQLExecutionError);
+    auto waited = std::chrono::steady_clock::now() - start;
+    ASSERT_GE(waited, std::chrono::milliseconds(100));
+    ASSERT_LT(waited, std::chrono::milliseconds(400));
+    ASSERT_EQ(reader.busy_stats().retries, 0);
+}
+
+TEST_F(BusyHandlerTest, RetriesReads)
+{
+    sqlite3* handle = nullptr;
+    ASSERT_EQ(sqlite3_open(":memory:", &handle), SQLITE_OK);
+    {
+        BusyHandler handler(handle);
+        handler.install({
+            .initial_backoff = std::chrono::milliseconds(1),
+            .max_wait = std::chrono::milliseconds(200),
+            .max_retries = 5,
+        });
+
+        // e.g. sqlite returned busy without waiting, to avoid a deadlock
+        int n_runs = 0;
+        auto busy_twice = [&]() { return ++n_runs < 3 ? SQLITE_BUSY : SQLITE_ROW; };
+        ASSERT_EQ(handler.retry(SQLITE_BUSY, std::chrono::steady_clock::now(), busy_twice), SQLITE_ROW);
+        ASSERT_EQ(n_runs, 3);
+        ASSERT_EQ(handler.stats().retries, 3);
+
+        // nothing is left of the wait, so it isn't run again
+        n_runs = 0;
+        auto started = std::chrono::steady_clock::now() - std::chrono::milliseconds(200);
+        ASSERT_EQ(handler.retry(SQLITE_BUSY, started, busy_twice), SQLITE_BUSY);
+        ASSERT_EQ(n_runs, 0);
+    }
+    sqlite3_close(handle);
+}
@@ -0,0 +1,84 @@
+#include <gtest/gtest.h>
+#include <filesystem>
+#include "zxorm/zxorm.hpp"
+#include "logger.hpp"
+
+using namespace zxorm;
+
+struct OptionsObject {
+    int id = 0;
+};
+
+using options_table_t = Table<"options", OptionsObject,
+    Column<"id", &OptionsObject::id, PrimaryKey<>>
+>;
+
+using options_connection_t = Connection<options_table_t>;
+
+class ConnectionOptionsTest : public ::testing::Test {
+    protected:
+    void TearDown() override {
+        std::filesystem::remove("test.db");
+        std::filesystem::remove("test.db-wal");
+        std::filesystem::remove("test.db-shm");
+    }
+};
+
+TEST_F(ConnectionOptionsTest, DefaultOptions)
+{
+    options_connection_t connection("test.db", 0, nullptr, &logger);
+    auto options = connection.options();
+    ASSERT_TRUE(options.foreign_keys);
+    ASSERT_EQ(options.journal_mode, journal_mode_t::delete_);
+}
+
+TEST_F(ConnectionOptionsTest, AppliedAtOpen)
+{
+    ConnectionOptions requested = {
+        .foreign_keys = false,
+        .journal_mode = journal_mode_t::wal,
+        .synchronous = synchronous_t::normal,
+        .cache_size = -4096,
+        .temp_store = temp_store_t::memory,
+        .page_size = 8192,
+        .busy_timeout = std::chrono::milliseconds(1234),
+        .threads = 2,
+    };
+
+    options_connection_t connection("test.db", requested, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, nullptr, &logger);
+    connection.create_tables();
+
+    auto options = connection.options();
+    ASSERT_FALSE(options.foreign_keys);
+    ASSERT_EQ(options.journal_mode, journal_mode_t::wal);
+    ASSERT_EQ(options.synchronous, synchronous_t::normal);
+    ASSERT_EQ(options.cache_size, -4096);
+    ASSERT_EQ(options.temp_store, temp_store_t::memory);
+    ASSERT_EQ(options.page_size, 8192);
+    ASSERT_EQ(options.busy_timeout, std::chrono::milliseconds(1234));
+    ASSERT_EQ(options.threads, 2);
+}
+
+TEST_F(ConnectionOptionsTest, BusyTimeoutIsTheBusyStrategyBudget)
+{
+    auto requested = ConnectionOptions::durable();
+    requested.busy_strategy = busy_strategy_t{ .max_wait = std::chrono::milliseconds(10) };
+
+    options_connection_t connection("test.db", requested);
+    auto options = connection.options();
+    ASSERT_EQ(options.busy_timeout, std::chrono::seconds(5));
+    ASSERT_TRUE(options.busy_strategy.has_value());
+    ASSERT_EQ(options.busy_strategy->max_wait, std::chrono::seconds(5));
+}
+
+TEST_F(ConnectionOptionsTest, Presets)
+{
+    options_connection_t connection("test.db", ConnectionOptions::read_mostly());
+    auto options = connection.options();
+    ASSERT_EQ(options.journal_mode, journal_mode_t::wal);
+    ASSERT_EQ(options.synchronous, synchronous_t::normal);
+    ASSERT_EQ(options.temp_store, temp_store_t::memory);
+
+    // WAL can't be used for an in-memory database
+    ASSERT_THROW(options_connection_t(":memory:", ConnectionOptions::durable()), InternalError);
+}
@@ -0,0 +1,156 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <filesystem>
+#include <thread>
+#include "zxorm/zxorm.hpp"
+#include "logger.hpp"
+
+using namespace zxorm;
+
+struct PooledObject {
+    int id = 0;
+    int value = 0;
+};
+
+using pooled_table_t = Table<"pooled", PooledObject,
+    Column<"id", &PooledObject::id, PrimaryKey<>>,
+    Column<"value", &PooledObject::value>
+>;
+
+using pool_t = ConnectionPool<pooled_table_t>;
+
+class ConnectionPoolTest : public ::testing::Test {
+    protected:
+    void SetUp() override {
+        pool = std::make_shared<pool_t>("test.db", 4, &logger);
+        pool->create_tables();
+    }
+
+    std::shared_ptr<pool_t> pool;
+
+    void TearDown() override {
+        pool = nullptr;
+        std::filesystem::remove("test.db");
+        std::filesystem::remove("test.db-wal");
+        std::filesystem::remove("test.db-shm");
+    }
+};
+
+TEST_F(ConnectionPoolTest, UsesWal)
+{
+    ASSERT_EQ(pool->writer()->journal_mode(), journal_mode_t::wal);
+    ASSERT_EQ(pool->reader()->journal_mode(), journal_mode_t::wal);
+    ASSERT_EQ(pool->n_readers(), 4);
+}
+
+TEST_F(ConnectionPoolTest, ReadersAreReadOnly)
+{
+    PooledObject obj;
+    ASSERT_THROW(pool->reader()->insert_record(obj), SQLExecutionError);
+
+    pool->insert_record(obj);
+    ASSERT_EQ(obj.id, 1);
+    ASSERT_TRUE(pool->find_record<PooledObject>(1).has_value());
+}
+
+TEST_F(ConnectionPoolTest, ConcurrentReadsDuringWrites)
+{
+    constexpr int n_writes = 200;
+    std::atomic<bool> writing = true;
+    std::atomic<int> n_reads = 0;
+
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 6; i++) {
+        readers.emplace_back([&]() {
+            int last_seen = 0;
+            while (writing) {
+                auto last = pool->last<PooledObject>();
+                int seen = last ? last->id : 0;
+                // committed writes never disappear
+                ASSERT_GE(seen, last_seen);
+                last_seen = seen;
+                n_reads++;
+            }
+        });
+    }
+
+    for (int i = 0; i < n_writes; i++) {
+        PooledObject obj { .value = i };
+        pool->insert_record(obj);
+    }
+    writing = false;
+
+    for (auto& t : readers) {
+        t.join();
+    }
+
+    ASSERT_GT(n_reads, 0);
+    ASSERT_EQ(pool->last<PooledObject>()->id, n_writes);
+}
+
+TEST_F(ConnectionPoolTest, Transaction)
+{
+    ASSERT_THROW(pool->transaction([](auto& connection) {
+        PooledObject obj;
+        connection.insert_record(obj);
+        connection.update_record(PooledObject{ .id = 100 });
+        throw InternalError("roll it back");
+    }), InternalError);
+
+    ASSERT_FALSE(pool->first<PooledObject>().has_value());
+}
+
+TEST_F(ConnectionPoolTest, WalCheckpointer)
+{
+    pool->start_wal_checkpointer({
+        .interval = std::chrono::milliseconds(5),
+        .truncate_threshold = 0,
+    });
+    auto checkpointer = pool->wal_checkpointer();
+    ASSERT_NE(checkpointer, nullptr);
+
+    std::vector<PooledObject> objects(1000);
+    pool->insert_many_records(objects);
+    ASSERT_GT(std::filesystem::file_size("test.db-wal"), 0);
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (checkpointer->stats().truncates == 0 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+
+    auto stats = checkpointer->stats();
+    ASSERT_GT(stats.checkpoints, 0);
+    ASSERT_GT(stats.truncates, 0);
+    ASSERT_GT(stats.total_duration.count(), 0);
+
+    // the writer no longer checkpoints when it commits
+    ASSERT_TRUE(checkpointer->checkpoint(wal_checkpoint_mode_t::truncate));
+    ASSERT_EQ(std::filesystem::file_size("test.db-wal"), 0);
+    ASSERT_EQ(pool->read([](auto& connection) { return connection.template select_query<Count<pooled_table_t>>().one().exec(); }), 1000);
+
+    pool->stop_wal_checkpointer();
+    ASSERT_EQ(pool->wal_checkpointer(), nullptr);
+}
+
+TEST_F(ConnectionPoolTest, ReadsReleaseTheirSnapshot)
+{
+    std::vector<PooledObject> objects(10);
+    pool->insert_many_records(objects);
+
+    // a checkpoint that has to wait for readers fails, instead of waiting, if any are still reading
+    WalCheckpointer checkpointer("test.db", {
+        .interval = std::chrono::hours(1),
+        .busy_timeout = std::chrono::milliseconds(0),
+    });
+
+    auto reader = pool->reader();
+    ASSERT_TRUE(reader->find_record<PooledObject>(1).has_value());
+    ASSERT_TRUE(reader->first<PooledObject>().has_value());
+    {
+        auto results = reader->select_query<PooledObject>().many().exec();
+        ASSERT_EQ((*results.begin()).id, 1);
+    }
+
+    ASSERT_TRUE(checkpointer.checkpoint(wal_checkpoint_mode_t::truncate));
+    ASSERT_EQ(checkpointer.stats().busy, 0);
+}
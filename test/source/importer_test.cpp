@@ -0,0 +1,181 @@
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <sstream>
+#include "zxorm/zxorm.hpp"
+#include "logger.hpp"
+
+using namespace zxorm;
+
+struct Reading {
+    int id = 0;
+    std::string sensor;
+    double value = 0;
+    bool calibrated = false;
+    std::optional<std::string> note = std::nullopt;
+};
+
+using reading_table_t = Table<"readings", Reading,
+    Column<"id", &Reading::id, PrimaryKey<>>,
+    Column<"sensor", &Reading::sensor>,
+    Column<"value", &Reading::value>,
+    Column<"calibrated", &Reading::calibrated>,
+    Column<"note", &Reading::note>
+>;
+
+using importer_connection_t = Connection<reading_table_t>;
+
+class ImporterTest : public ::testing::Test {
+    protected:
+    void SetUp() override {
+        my_conn = std::make_shared<importer_connection_t>("test.db", 0, nullptr, &logger);
+        my_conn->create_tables();
+    }
+
+    std::shared_ptr<importer_connection_t> my_conn;
+
+    size_t n_readings() {
+        return my_conn->select_query<Count<reading_table_t>>().one().exec().value();
+    }
+
+    void TearDown() override {
+        my_conn = nullptr;
+        std::filesystem::remove("test.db");
+    }
+};
+
+TEST_F(ImporterTest, CSV)
+{
+    // columns in any order, quoted delimiters, quotes & line breaks, and an empty field is null
+    std::istringstream in(
+        "id,calibrated,value,sensor,note\r\n"
+        "1,true,1.5,\"north, upper\",\"said \"\"hi\"\"\"\r\n"
+        "2,0,-3,south,\r\n"
+        "\r\n"
+        "3,1,2e3,east,\"two\nlines\"\r\n"
+        "4,false,0,west,\"\"\r\n");
+
+    auto stats = my_conn->import_records<Reading>(in, { .batch_size = 2 });
+    ASSERT_EQ(stats.rows, 4);
+    ASSERT_EQ(stats.batches, 2);
+    ASSERT_EQ(n_readings(), 4);
+
+    auto first = my_conn->find_record<Reading>(1);
+    ASSERT_TRUE(first.has_value());
+    ASSERT_EQ(first->sensor, "north, upper");
+    ASSERT_EQ(first->value, 1.5);
+    ASSERT_TRUE(first->calibrated);
+    ASSERT_EQ(first->note, "said \"hi\"");
+
+    auto second = my_conn->find_record<Reading>(2);
+    ASSERT_EQ(second->value, -3);
+    ASSERT_FALSE(second->calibrated);
+    ASSERT_FALSE(second->note.has_value());
+
+    ASSERT_EQ(my_conn->find_record<Reading>(3)->note, "two\nlines");
+    ASSERT_EQ(my_conn->find_record<Reading>(3)->value, 2000);
+    // a quoted empty field is an empty string, not null
+    ASSERT_EQ(my_conn->find_record<Reading>(4)->note, "");
+}
+
+TEST_F(ImporterTest, CSVWithoutHeader)
+{
+    std::istringstream in("1;a;1;1;\n2;b;2;0;note\n");
+    auto stats = my_conn->import_records<Reading>(in, { .delimiter = ';', .has_header = false });
+    ASSERT_EQ(stats.rows, 2);
+    ASSERT_EQ(my_conn->find_record<Reading>(2)->note, "note");
+}
+
+TEST_F(ImporterTest, JSONLines)
+{
+    std::istringstream in(
+        R"({"id": 1, "sensor": "café 😀", "value": 0.25, "calibrated": true, "note": null})" "\n"
+        R"({"sensor":"b\"\\","value":-1e-2,"id":2,"extra":"ignored"})" "\n"
+        "\n");
+
+    auto stats = my_conn->import_records<Reading>(in, {
+        .format = import_format_t::ndjson,
+        .ignore_unknown_fields = true,
+    });
+    ASSERT_EQ(stats.rows, 2);
+
+    auto first = my_conn->find_record<Reading>(1);
+    ASSERT_EQ(first->sensor, "caf\xc3\xa9 \xf0\x9f\x98\x80");
+    ASSERT_EQ(first->value, 0.25);
+    ASSERT_TRUE(first->calibrated);
+    ASSERT_FALSE(first->note.has_value());
+
+    auto second = my_conn->find_record<Reading>(2);
+    ASSERT_EQ(second->sensor, "b\"\\");
+    ASSERT_EQ(second->value, -0.01);
+    // missing fields keep the default value
+    ASSERT_FALSE(second->calibrated);
+}
+
+TEST_F(ImporterTest, JSONUnicodeEscapes)
+{
+    std::istringstream in(R"({"id": 1, "sensor": "caf\u00e9 \ud83d\ude00 \u20ac"})" "\n");
+
+    my_conn->import_records<Reading>(in, { .format = import_format_t::ndjson });
+    ASSERT_EQ(my_conn->find_record<Reading>(1)->sensor, "caf\xc3\xa9 \xf0\x9f\x98\x80 \xe2\x82\xac");
+}
+
+TEST_F(ImporterTest, ParallelParsingKeepsOrder)
+{
+    std::ostringstream out;
+    out << "sensor,value\n";
+    for (int i = 0; i < 5000; i++) {
+        out << "s" << i << "," << i << "\n";
+    }
+    std::istringstream in(out.str());
+
+    auto stats = my_conn->import_records<Reading>(in, { .batch_size = 128, .n_parser_threads = 4 });
+    ASSERT_EQ(stats.rows, 5000);
+    ASSERT_EQ(n_readings(), 5000);
+
+    // auto incremented ids show the order the records were inserted in
+    for (int id : {1, 129, 2500, 5000}) {
+        auto reading = my_conn->find_record<Reading>(id);
+        ASSERT_EQ(reading->sensor, "s" + std::to_string(id - 1));
+        ASSERT_EQ(reading->value, id - 1);
+    }
+}
+
+TEST_F(ImporterTest, ErrorsRollBack)
+{
+    auto import = [&](std::string data, import_options_t options = {}) {
+        std::istringstream in(std::move(data));
+        my_conn->import_records<Reading>(in, options);
+    };
+
+    // the first batch is inserted before the bad record is parsed
+    for (size_t n_parser_threads : {size_t{1}, size_t{3}}) {
+        try {
+            import("sensor,value\na,1\nb,2\nc,oops\n", { .batch_size = 1, .n_parser_threads = n_parser_threads });
+            FAIL() << "expected an ImportError";
+        } catch (const ImportError& e) {
+            ASSERT_EQ(std::string_view(e), "Record 3: column value: Invalid number: oops");
+        }
+        ASSERT_EQ(n_readings(), 0);
+    }
+
+    ASSERT_THROW(import("sensor,unknown\na,1\n"), ImportError);
+    ASSERT_THROW(import("sensor,value\na\n"), ImportError);
+    ASSERT_THROW(import("sensor,value\n\"a,1\n"), ImportError);
+    ASSERT_THROW(import("sensor,value\na,\n"), ImportError);
+    ASSERT_THROW(import(R"({"sensor": {"nested": 1}})", { .format = import_format_t::ndjson }), ImportError);
+    ASSERT_THROW(import(R"({"sensor": "a"} trailing)", { .format = import_format_t::ndjson }), ImportError);
+    // half of a surrogate pair
+    ASSERT_THROW(import(R"({"sensor": "\ud83d"})", { .format = import_format_t::ndjson }), ImportError);
+    ASSERT_THROW(import(R"({"sensor": "\ud83d\u0041"})", { .format = import_format_t::ndjson }), ImportError);
+    ASSERT_THROW(import(R"({"sensor": "\ude00"})", { .format = import_format_t::ndjson }), ImportError);
+
+    // inserted records are given new ids, unless upserting
+    my_conn->insert_record(Reading{ .sensor = "old" });
+    import("id,sensor\n1,new\n");
+    ASSERT_EQ(my_conn->find_record<Reading>(1)->sensor, "old");
+    ASSERT_EQ(my_conn->find_record<Reading>(2)->sensor, "new");
+
+    import("id,sensor\n1,newer\n", { .upsert = true });
+    ASSERT_EQ(my_conn->find_record<Reading>(1)->sensor, "newer");
+    ASSERT_EQ(n_readings(), 2);
+}
@@ -1,5 +1,6 @@
 #include <gtest/gtest.h>
 #include <filesystem>
+#include <thread>
 #include "zxorm/zxorm.hpp"
 #include "logger.hpp"
 
@@ -695,6 +696,135 @@ TEST_F(QueryTest, InsertMany)
     }
 }
 
+TEST_F(QueryTest, InsertManyStats)
+{
+    std::vector<Object> objects(100);
+    auto stats = my_conn->insert_many_records(objects);
+
+    ASSERT_EQ(stats.rows, 100);
+    // 64 + 32 + 4
+    ASSERT_EQ(stats.statements, 3);
+    ASSERT_GT(stats.rows_per_second(), 0);
+
+    stats = my_conn->insert_many_records(objects, 10);
+    ASSERT_EQ(stats.rows, 100);
+    // batches of 8, and 4 for the remainder
+    ASSERT_EQ(stats.statements, 13);
+
+    auto count = my_conn->select_query<CountAll, From<Object>>().one().exec();
+    ASSERT_EQ(count, 200);
+}
+
+TEST_F(QueryTest, InsertManyBatchesEveryRange)
+{
+    // 64 + 32 + 4 rows, however the records are passed
+    std::vector<Object> objects(100);
+    ASSERT_EQ(my_conn->insert_many_records(objects).statements, 3);
+    ASSERT_EQ(my_conn->insert_many_records(std::as_const(objects)).statements, 3);
+    ASSERT_EQ(my_conn->insert_many_records(std::vector<Object>(100)).statements, 3);
+    ASSERT_EQ(my_conn->insert_many_records(objects | std::views::take(100)).statements, 3);
+    ASSERT_EQ(my_conn->insert_many_records(objects, set_rowids).statements, 3);
+    ASSERT_EQ(my_conn->upsert_many_records(objects).statements, 3);
+    ASSERT_EQ(my_conn->upsert_many_records(objects, set_rowids).statements, 3);
+
+    auto count = my_conn->select_query<CountAll, From<Object>>().one().exec();
+    ASSERT_EQ(count, 500);
+}
+
+TEST_F(QueryTest, InsertManyFromInputRange)
+{
+    auto objects = std::views::iota(0, 150) | std::views::transform([](int i) {
+        return Object{ .some_id = i, .some_text = std::to_string(i) };
+    });
+
+    auto stats = my_conn->insert_many_records(objects);
+    ASSERT_EQ(stats.rows, 150);
+
+    auto inserted = my_conn->select_query<Object>().many().exec().to_vector();
+    ASSERT_EQ(150, inserted.size());
+    for (int i = 0; i < 150; i++) {
+        ASSERT_EQ(i, inserted[i].some_id);
+        ASSERT_EQ(std::to_string(i), inserted[i].some_text);
+    }
+}
+
+TEST_F(QueryTest, InsertManySetsRowids)
+{
+    my_conn->insert_record(Object{});
+
+    std::vector<Object> objects(100);
+    for (int i = 0; i < 100; i++) {
+        objects[i].some_id = i;
+    }
+
+    auto stats = my_conn->insert_many_records(objects, set_rowids);
+    // 64 + 32 + 4
+    ASSERT_EQ(stats.statements, 3);
+    for (int i = 0; i < 100; i++) {
+        ASSERT_EQ(objects[i].id, i + 2);
+        auto found = my_conn->find_record<Object>(objects[i].id);
+        ASSERT_TRUE(found.has_value());
+        ASSERT_EQ(found->some_id, i);
+    }
+
+    // the rowids follow the largest one, even after a gap
+    my_conn->delete_record<Object>(50);
+    std::vector<Object> more(3);
+    my_conn->insert_many_records(more, set_rowids);
+    ASSERT_EQ(more[0].id, 102);
+    ASSERT_EQ(more[2].id, 104);
+
+    // otherwise the records are left alone
+    std::vector<Object> left_alone(3);
+    my_conn->insert_many_records(left_alone);
+    for (const auto& o : left_alone) {
+        ASSERT_EQ(o.id, 0);
+    }
+    ASSERT_TRUE(my_conn->find_record<Object>(105).has_value());
+}
+
+TEST_F(QueryTest, InsertManyInsideTransaction)
+{
+    my_conn->transaction([&]() {
+        my_conn->insert_many_records(std::vector<Object>(5));
+        my_conn->insert_record(Object{});
+    });
+
+    auto count = my_conn->select_query<CountAll, From<Object>>().one().exec();
+    ASSERT_EQ(count, 6);
+}
+
+TEST_F(QueryTest, BufferedWriter)
+{
+    auto count = [&]() { return my_conn->select_query<CountAll, From<Object>>().one().exec().value(); };
+    {
+        auto writer = my_conn->buffered_writer<Object>({ .max_rows = 10, .max_age = std::chrono::hours(1) });
+        for (int i = 0; i < 25; i++) {
+            writer.write(Object{ .some_id = i });
+        }
+        ASSERT_EQ(writer.size(), 5);
+        ASSERT_EQ(writer.stats().flushes, 2);
+        ASSERT_EQ(writer.stats().rows, 20);
+        ASSERT_FALSE(writer.flush_if_due());
+        ASSERT_EQ(count(), 20);
+    }
+    // the rest are flushed when the writer is destroyed
+    ASSERT_EQ(count(), 25);
+
+    auto writer = my_conn->buffered_writer<Object>({
+        .max_bytes = 4096,
+        .max_age = std::chrono::milliseconds(10),
+    });
+    writer.write(Object{ .some_text = std::string(5000, 'x') });
+    ASSERT_EQ(writer.size(), 0);
+
+    writer.write(Object{});
+    ASSERT_EQ(writer.size(), 1);
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    ASSERT_TRUE(writer.flush_if_due());
+    ASSERT_EQ(count(), 27);
+}
+
 TEST_F(QueryTest, DeleteWhere)
 {
     std::vector<Object> objects;
@@ -808,6 +938,213 @@ TEST_F(QueryTest, SelectSeveralColumns)
     ASSERT_EQ(text, "yes");
 }
 
+TEST_F(QueryTest, SelectToColumns)
+{
+    std::vector<Object> objects(100);
+    for (size_t i = 0; i < objects.size(); i++) {
+        objects[i].some_id = i;
+        objects[i].some_bool = i % 2;
+        if (i % 3 == 0) {
+            objects[i].some_optional = i * 1.5;
+        }
+    }
+    my_conn->insert_many_records(objects);
+
+    auto columns = my_conn->select_query<Object>().many().to_columns();
+    ASSERT_EQ(columns.size(), 100);
+    ASSERT_EQ(columns.n_columns, table_t::n_columns);
+
+    auto& ids = columns.get<table_t::field_t<"some_id">>();
+    auto& bools = columns.get<table_t::field_t<"bool">>();
+    auto& optionals = columns.get<table_t::field_t<"some_optional">>();
+    ASSERT_EQ(ids.size(), 100);
+    for (size_t i = 0; i < 100; i++) {
+        ASSERT_EQ(ids[i], i);
+        ASSERT_EQ(bools[i], i % 2);
+        ASSERT_EQ(optionals.is_null(i), i % 3 != 0);
+        if (i % 3 == 0) {
+            ASSERT_EQ(optionals[i], i * 1.5f);
+        }
+    }
+    ASSERT_EQ(columns.get<1>().values[0], Object{}.some_text);
+}
+
+TEST_F(QueryTest, FetchColumnsInChunks)
+{
+    my_conn->insert_many_records(std::vector<Object>(25));
+
+    auto query = my_conn->select_query<
+        Select<table_t::field_t<"id">, CountAll>,
+        From<Object>
+    >().group_by<table_t::field_t<"id">>().many();
+
+    decltype(query)::column_results_t chunk;
+    std::vector<int> ids;
+    size_t n_chunks = 0;
+    while (query.fetch_columns(chunk, 10)) {
+        n_chunks++;
+        auto& id_values = chunk.get<0>().values;
+        ids.insert(ids.end(), id_values.begin(), id_values.end());
+        for (auto count : chunk.get<1>().values) {
+            ASSERT_EQ(count, 1);
+        }
+        chunk.clear();
+    }
+
+    ASSERT_EQ(n_chunks, 3);
+    ASSERT_EQ(ids.size(), 25);
+    ASSERT_EQ(ids.back(), 25);
+
+    // starts again once every row has been fetched
+    ASSERT_EQ(query.fetch_columns(chunk, 100), 25);
+}
+
+TEST_F(QueryTest, FetchColumnsExactMultipleOfChunk)
+{
+    my_conn->insert_many_records(std::vector<Object>(4));
+
+    auto query = my_conn->select_query<Object>().many();
+
+    decltype(query)::column_results_t chunk;
+    ASSERT_EQ(query.fetch_columns(chunk, 2), 2);
+    ASSERT_EQ(query.fetch_columns(chunk, 2), 2);
+    ASSERT_EQ(query.fetch_columns(chunk, 2), 0);
+    ASSERT_EQ(chunk.size(), 4);
+
+    // starts again after a single empty fetch
+    chunk.clear();
+    ASSERT_EQ(query.fetch_columns(chunk, 2), 2);
+    ASSERT_EQ(chunk.get<table_t::field_t<"id">>()[0], 1);
+}
+
+TEST_F(QueryTest, FetchIntoReusedBuffer)
+{
+    std::vector<Object> objects(25);
+    for (size_t i = 0; i < objects.size(); i++) {
+        objects[i].some_text = std::string(i + 1, 'a');
+        objects[i].some_optional = i % 2 ? std::optional<float>(i) : std::nullopt;
+    }
+    my_conn->insert_many_records(objects);
+
+    auto query = my_conn->select_query<Object>().many();
+
+    std::array<Object, 10> buffer;
+    for (auto& o : buffer) {
+        o.some_text.reserve(64);
+        o.some_optional = 100;
+    }
+    const char* text_storage = buffer[0].some_text.data();
+
+    std::vector<Object> fetched;
+    while (size_t n = query.fetch(buffer)) {
+        fetched.insert(fetched.end(), buffer.begin(), buffer.begin() + n);
+        // the strings are read into their existing capacity
+        ASSERT_EQ(buffer[0].some_text.data(), text_storage);
+    }
+
+    ASSERT_EQ(fetched.size(), objects.size());
+    for (size_t i = 0; i < fetched.size(); i++) {
+        ASSERT_EQ(fetched[i].id, i + 1);
+        ASSERT_EQ(fetched[i].some_text, objects[i].some_text);
+        ASSERT_EQ(fetched[i].some_optional, objects[i].some_optional);
+    }
+
+    auto all = query.exec().to_vector(objects.size());
+    ASSERT_EQ(all.size(), objects.size());
+    ASSERT_EQ(all.back().some_text, objects.back().some_text);
+}
+
+TEST_F(QueryTest, FetchExactMultipleOfBuffer)
+{
+    my_conn->insert_many_records(std::vector<Object>(4));
+
+    auto query = my_conn->select_query<Object>().many();
+
+    std::array<Object, 2> buffer;
+    ASSERT_EQ(query.fetch(buffer), 2);
+    ASSERT_EQ(query.fetch(buffer), 2);
+    ASSERT_EQ(buffer[1].id, 4);
+    ASSERT_EQ(query.fetch(buffer), 0);
+
+    // starts again after a single empty fetch
+    ASSERT_EQ(query.fetch(buffer), 2);
+    ASSERT_EQ(buffer[0].id, 1);
+}
+
+TEST_F(QueryTest, FetchAfterPartlyConsumedResults)
+{
+    my_conn->insert_many_records(std::vector<Object>(4));
+
+    auto query = my_conn->select_query<Object>().many();
+    {
+        auto results = query.exec();
+        ASSERT_EQ((*results.begin()).id, 1);
+    }
+
+    // the abandoned read doesn't leave the query looking exhausted
+    std::array<Object, 3> buffer;
+    ASSERT_EQ(query.fetch(buffer), 3);
+    ASSERT_EQ(buffer[0].id, 1);
+}
+
+TEST_F(QueryTest, ResultsAreAnInputRange)
+{
+    std::vector<Object> objects(20);
+    for (size_t i = 0; i < objects.size(); i++) {
+        objects[i].some_id = i;
+    }
+    my_conn->insert_many_records(objects);
+
+    auto query = my_conn->select_query<Object>().many();
+    static_assert(std::ranges::input_range<decltype(query.exec())>);
+
+    std::vector<int> odd_ids;
+    for (int id : query.exec()
+            | std::views::filter([](const Object& o) { return o.some_id % 2; })
+            | std::views::transform(&Object::some_id)
+            | std::views::take(3)) {
+        odd_ids.push_back(id);
+    }
+
+    ASSERT_EQ(odd_ids, std::vector<int>({ 1, 3, 5 }));
+}
+
+TEST_F(QueryTest, StreamRecords)
+{
+    std::vector<Object> objects(250);
+    for (size_t i = 0; i < objects.size(); i++) {
+        objects[i].some_id = i;
+    }
+    my_conn->insert_many_records(objects);
+
+    size_t n_chunks = 0;
+    for (auto chunk : my_conn->stream_chunks<Object>(100)) {
+        ASSERT_EQ(chunk.size(), n_chunks < 2 ? 100 : 50);
+        ASSERT_EQ(chunk.front().id, n_chunks * 100 + 1);
+        n_chunks++;
+    }
+    ASSERT_EQ(n_chunks, 3);
+
+    auto stream = my_conn->stream_records<Object>(100);
+    int expected_id = 1;
+    for (Object& o : stream) {
+        ASSERT_EQ(o.id, expected_id);
+        ASSERT_EQ(o.some_id, expected_id - 1);
+
+        // nothing is being read between chunks, so the table can be written to,
+        // and the stream carries on from the last id it read
+        if (o.id == 100) {
+            my_conn->delete_record<Object>(101);
+            Object appended;
+            appended.some_id = 250;
+            my_conn->insert_record(appended);
+        }
+
+        expected_id += o.id == 100 ? 2 : 1;
+    }
+    ASSERT_EQ(expected_id, 252);
+}
+
 TEST_F(QueryTest, ReuseAQuery)
 {
     Object obj;
@@ -863,6 +1200,41 @@ TEST_F(QueryTest, ReuseAQueryWithMultipleBinds)
     ASSERT_EQ(vec[1], 3.14f * 4);
 }
 
+TEST_F(QueryTest, BorrowedBindingsOutliveTheQuery)
+{
+    Object obj;
+    for (size_t i = 0; i < 4; i++) {
+        obj.some_text = std::string("hello") + std::to_string(i);
+        my_conn->insert_record(obj);
+    }
+
+    // the prepared query & the string it was bound with are both temporaries
+    auto results = my_conn->select_query<Object>()
+        .where_many(table_t::field_t<"text">().like(std::string("hello%"))).exec();
+
+    ASSERT_EQ(results.to_vector().size(), 4);
+
+    auto query = my_conn->select_query<Object>()
+        .where_many(table_t::field_t<"text">().like(std::string("hello%")));
+
+    query.rebind(std::string("hello2"));
+    auto vec = query.exec().to_vector();
+    ASSERT_EQ(vec.size(), 1);
+    ASSERT_EQ(vec[0].some_text, "hello2");
+}
+
+TEST_F(QueryTest, BindEmptyString)
+{
+    Object obj;
+    obj.some_text = "";
+    my_conn->insert_record(obj);
+
+    auto result = my_conn->select_query<CountAll, From<Object>>()
+        .where_one(table_t::field_t<"text">().like("")).exec();
+
+    ASSERT_EQ(result.value(), 1);
+}
+
 TEST_F(QueryTest, AbortedUniqueConstraintThrows)
 {
     my_conn->insert_record(ConstrainedObj{.number = 10});
@@ -874,6 +1246,34 @@ TEST_F(QueryTest, AbortedNotNullConstraintThrows)
     ASSERT_THROW(my_conn->insert_record(ConstrainedObj{.nullable = std::nullopt}), SQLConstraintError);
 }
 
+struct TypedObj {
+    int id = 0;
+    int number = 0;
+};
+using typed_table_t = Table<"test5", TypedObj,
+    Column<"id", &TypedObj::id, PrimaryKey<>>,
+    Column<"number", &TypedObj::number, NotNull<>>
+    >;
+
+TEST_F(QueryTest, WrongTypeInNotNullColumnThrows)
+{
+#ifdef NDEBUG
+    GTEST_SKIP() << "The types of NOT NULL columns are only checked in debug builds";
+#endif
+    my_conn = nullptr;
+    auto conn = Connection<typed_table_t>("test.db", 0, nullptr, &logger);
+    conn.create_tables();
+    conn.insert_record(TypedObj{ .number = 1 });
+
+    // sqlite doesn't stop a text value being stored in an integer column
+    sqlite3* handle;
+    ASSERT_EQ(sqlite3_open("test.db", &handle), SQLITE_OK);
+    ASSERT_EQ(sqlite3_exec(handle, "UPDATE `test5` SET `number` = 'one';", nullptr, nullptr, nullptr), SQLITE_OK);
+    sqlite3_close(handle);
+
+    ASSERT_THROW(std::ignore = conn.find_record<TypedObj>(1), InternalError);
+}
+
 struct DuplicateColumnName {
     int id;
     int number;
@@ -889,3 +1289,349 @@ TEST_F(QueryTest, DuplicateColumnNameThrows)
     auto conn = Connection<duplicate_column_name_table_t>("test.db", 0, nullptr, &logger);
     ASSERT_THROW(conn.create_tables(), SQLExecutionError);
 }
+
+TEST_F(QueryTest, StatementCacheReusesAdHocQueries)
+{
+    my_conn->insert_record(Object{ .some_id = 7 });
+
+    auto run = [&]() {
+        return my_conn->select_query<Object>()
+            .where_one(table_t::field_t<"some_id">() == 7).exec();
+    };
+
+    ASSERT_TRUE(run().has_value());
+    auto before = my_conn->statement_cache_stats();
+
+    for (int i = 0; i < 10; i++) {
+        ASSERT_TRUE(run().has_value());
+    }
+
+    auto after = my_conn->statement_cache_stats();
+    ASSERT_EQ(after.hits - before.hits, 10);
+    ASSERT_EQ(after.misses, before.misses);
+}
+
+TEST_F(QueryTest, StatementCacheDoesNotShareBusyStatements)
+{
+    for (int i = 0; i < 3; i++) {
+        my_conn->insert_record(Object{ .some_id = 8 });
+    }
+
+    auto query = [&]() {
+        return my_conn->select_query<Object>()
+            .where_many(table_t::field_t<"some_id">() == 8);
+    };
+
+    auto outer = query();
+    size_t n = 0;
+    for (const auto& a : outer.exec()) {
+        ASSERT_EQ(a.some_id, 8);
+        // the same SQL, while the first statement is still being stepped
+        ASSERT_EQ(query().exec().to_vector().size(), 3);
+        n++;
+    }
+    ASSERT_EQ(n, 3);
+}
+
+TEST_F(QueryTest, CachedQueriesDoNotHoldCachedStatements)
+{
+    my_conn->insert_record(Object{});
+    ASSERT_TRUE(my_conn->find_record<Object>(1).has_value());
+
+    // the same SQL as `find_record`, which keeps its own statement
+    auto by_id = [&]() { return my_conn->select_query<Object>().where_one(table_t::field_t<"id">() == 1).exec(); };
+
+    ASSERT_TRUE(by_id().has_value());
+    auto before = my_conn->statement_cache_stats();
+    ASSERT_TRUE(by_id().has_value());
+    auto after = my_conn->statement_cache_stats();
+    ASSERT_EQ(after.hits - before.hits, 1);
+    ASSERT_EQ(after.misses, before.misses);
+}
+
+TEST_F(QueryTest, StatementCacheEvictsLeastRecentlyUsed)
+{
+    my_conn->set_statement_cache_capacity(2);
+    auto stats = my_conn->statement_cache_stats();
+    ASSERT_LE(stats.size, 2);
+    ASSERT_EQ(stats.capacity, 2);
+
+    auto by_id = [&]() { return my_conn->select_query<Object>().where_one(table_t::field_t<"id">() == 1).exec(); };
+    auto by_some_id = [&]() { return my_conn->select_query<Object>().where_one(table_t::field_t<"some_id">() == 1).exec(); };
+    auto by_float = [&]() { return my_conn->select_query<Object>().where_one(table_t::field_t<"float">() == 1.0).exec(); };
+
+    by_id();
+    by_some_id();
+    auto before = my_conn->statement_cache_stats();
+    by_float();
+    auto after = my_conn->statement_cache_stats();
+    ASSERT_EQ(after.evictions - before.evictions, 1);
+    ASSERT_EQ(after.size, 2);
+
+    // `by_id` was the least recently used, so it was evicted
+    by_some_id();
+    ASSERT_EQ(my_conn->statement_cache_stats().hits - after.hits, 1);
+    by_id();
+    ASSERT_EQ(my_conn->statement_cache_stats().misses - after.misses, 1);
+}
+
+TEST_F(QueryTest, CachedQuery)
+{
+    for (int i = 0; i < 3; i++) {
+        my_conn->insert_record(Object{ .some_id = i });
+    }
+
+    auto find_by_some_id = [&](int some_id) {
+        auto& query = my_conn->cached_query([](auto& connection) {
+            return connection.template select_query<Object>()
+                .where_one(table_t::field_t<"some_id">() == 0);
+        });
+        query.rebind(some_id);
+        return query.exec();
+    };
+
+    auto before = my_conn->statement_cache_stats();
+    for (int i = 0; i < 3; i++) {
+        auto result = find_by_some_id(i);
+        ASSERT_TRUE(result.has_value());
+        ASSERT_EQ(result->some_id, i);
+    }
+    ASSERT_FALSE(find_by_some_id(3).has_value());
+
+    // the query keeps its own statement, rather than one from the statement cache
+    auto after = my_conn->statement_cache_stats();
+    ASSERT_EQ(after.misses, before.misses);
+    ASSERT_EQ(after.hits, before.hits);
+}
+
+TEST_F(QueryTest, CachedQueryBuiltFromAnotherCachedQuery)
+{
+    my_conn->insert_record(Object{ .some_id = 1 });
+
+    auto cached = [&]() -> auto& {
+        return my_conn->cached_query([](auto& connection) {
+            auto& inner = connection.cached_query([](auto& c) {
+                return c.template select_query<Object>()
+                    .where_one(table_t::field_t<"id">() == 1);
+            });
+            EXPECT_TRUE(inner.exec().has_value());
+
+            return connection.template select_query<Object>()
+                .where_one(table_t::field_t<"some_id">() == 1);
+        });
+    };
+
+    auto before = my_conn->statement_cache_stats();
+    auto& query = cached();
+    ASSERT_TRUE(query.exec().has_value());
+    ASSERT_EQ(&cached(), &query);
+
+    // neither query took a statement from the statement cache
+    auto after = my_conn->statement_cache_stats();
+    ASSERT_EQ(after.misses, before.misses);
+    ASSERT_EQ(after.hits, before.hits);
+}
+
+TEST_F(QueryTest, FindWithDifferentKeyTypes)
+{
+    my_conn->insert_record(Object{ .some_id = 1 });
+    ASSERT_TRUE(my_conn->find_record<Object>(1).has_value());
+    ASSERT_TRUE(my_conn->find_record<Object>(1L).has_value());
+    ASSERT_TRUE(my_conn->find_record<Object>(short(1)).has_value());
+    ASSERT_FALSE(my_conn->find_record<Object>(2L).has_value());
+}
+
+TEST_F(QueryTest, UpsertRecord)
+{
+    Object obj { .some_text = "inserted" };
+    my_conn->upsert_record(obj);
+    ASSERT_EQ(obj.id, 1);
+
+    obj.some_text = "updated";
+    my_conn->upsert_record(obj);
+    ASSERT_EQ(obj.id, 1);
+
+    auto found = my_conn->find_record<Object>(1);
+    ASSERT_TRUE(found.has_value());
+    ASSERT_EQ(found->some_text, "updated");
+
+    auto count = my_conn->select_query<CountAll, From<Object>>().one().exec();
+    ASSERT_EQ(count, 1);
+}
+
+TEST_F(QueryTest, UpsertConflictsWithUniqueColumn)
+{
+    my_conn->insert_record(ConstrainedObj { .id = 1, .number = 42, .nullable = 1 });
+
+    // a different primary key, but the same unique number
+    my_conn->upsert_record(ConstrainedObj { .id = 2, .number = 42, .nullable = 7 });
+
+    auto all = my_conn->select_query<ConstrainedObj>().many().exec().to_vector();
+    ASSERT_EQ(all.size(), 1);
+    ASSERT_EQ(all[0].id, 1);
+    ASSERT_EQ(all[0].nullable, 7);
+}
+
+TEST_F(QueryTest, UpsertMany)
+{
+    std::vector<Object> objects(100);
+    for (int i = 0; i < 100; i++) {
+        objects[i].some_id = i;
+    }
+    my_conn->insert_many_records(objects, set_rowids);
+
+    for (auto& o : objects) {
+        o.some_text = "updated";
+    }
+
+    // half of these are new
+    for (int i = 0; i < 100; i++) {
+        objects.push_back(Object { .some_id = 100 + i, .some_text = "new" });
+    }
+
+    auto stats = my_conn->upsert_many_records(objects, set_rowids);
+    ASSERT_EQ(stats.rows, 200);
+
+    for (int i = 0; i < 200; i++) {
+        ASSERT_EQ(objects[i].id, i + 1);
+    }
+
+    auto all = my_conn->select_query<Object>().many().exec().to_vector();
+    ASSERT_EQ(all.size(), 200);
+    for (int i = 0; i < 200; i++) {
+        ASSERT_EQ(all[i].some_id, i);
+        ASSERT_EQ(all[i].some_text, i < 100 ? "updated" : "new");
+    }
+}
+
+TEST_F(QueryTest, UpsertManySetsRowidsOfConflictingRecords)
+{
+    ConstrainedObj ten { .number = 10 };
+    ConstrainedObj twenty { .number = 20 };
+    my_conn->insert_record(ten);
+    my_conn->insert_record(twenty);
+
+    // new & conflicting records are mixed, and none of them know their rowid
+    std::vector<ConstrainedObj> objects {
+        { .number = 30 }, { .number = 20 }, { .number = 40 }, { .number = 10 },
+    };
+    auto stats = my_conn->upsert_many_records(objects, set_rowids);
+    ASSERT_EQ(stats.statements, 1);
+
+    ASSERT_EQ(objects[1].id, twenty.id);
+    ASSERT_EQ(objects[3].id, ten.id);
+    for (const auto& o : objects) {
+        auto found = my_conn->find_record<ConstrainedObj>(o.id);
+        ASSERT_TRUE(found.has_value());
+        ASSERT_EQ(found->number, o.number);
+    }
+
+    // a new record with a rowid keeps it, and the next new record follows it
+    std::vector<ConstrainedObj> more { { .id = 100, .number = 50 }, { .number = 60 } };
+    my_conn->upsert_many_records(more, set_rowids);
+    ASSERT_EQ(more[0].id, 100);
+    ASSERT_EQ(more[1].id, 101);
+    ASSERT_EQ(my_conn->find_record<ConstrainedObj>(101)->number, 60);
+}
+
+TEST_F(QueryTest, UpdateMany)
+{
+    std::vector<Object> objects(50);
+    my_conn->insert_many_records(objects, set_rowids);
+
+    for (auto& o : objects) {
+        o.some_text = "updated";
+        o.some_id = o.id * 2;
+    }
+
+    ASSERT_EQ(my_conn->update_many_records(objects), 50);
+
+    for (const auto& o : my_conn->select_query<Object>().many().exec()) {
+        ASSERT_EQ(o.some_text, "updated");
+        ASSERT_EQ(o.some_id, o.id * 2);
+    }
+}
+
+TEST_F(QueryTest, UpdateManyFields)
+{
+    std::vector<Object> objects(50);
+    my_conn->insert_many_records(objects, set_rowids);
+
+    for (auto& o : objects) {
+        o.some_text = "not updated";
+        o.some_id = o.id * 2;
+    }
+
+    ASSERT_EQ(my_conn->update_many_records<table_t::field_t<"some_id">>(objects), 50);
+
+    for (const auto& o : my_conn->select_query<Object>().many().exec()) {
+        ASSERT_EQ(o.some_text, Object{}.some_text);
+        ASSERT_EQ(o.some_id, o.id * 2);
+    }
+}
+
+TEST_F(QueryTest, UpdateFields)
+{
+    Object obj;
+    obj.some_id = 1;
+    my_conn->insert_record(obj);
+
+    obj.some_text = "not updated";
+    obj.some_id = 2;
+    obj.some_float = 4.5;
+    my_conn->update_fields<table_t::field_t<"some_id">, table_t::field_t<"float">>(obj);
+
+    auto found = my_conn->find_record<Object>(obj.id);
+    ASSERT_TRUE(found.has_value());
+    ASSERT_EQ(found->some_text, Object{}.some_text);
+    ASSERT_EQ(found->some_id, 2);
+    ASSERT_EQ(found->some_float, 4.5);
+}
+
+TEST_F(QueryTest, UpdateQuery)
+{
+    my_conn->insert_many_records(std::vector<Object>(10));
+
+    auto query = my_conn->update_query<Object>()
+        .set(table_t::field_t<"text">() = "updated", table_t::field_t<"some_id">() = 7)
+        .where(table_t::field_t<"id">() > 5);
+    query.exec();
+
+    for (const auto& o : my_conn->select_query<Object>().many().exec()) {
+        if (o.id > 5) {
+            ASSERT_EQ(o.some_text, "updated");
+            ASSERT_EQ(o.some_id, 7);
+        } else {
+            ASSERT_EQ(o.some_text, Object{}.some_text);
+            ASSERT_EQ(o.some_id, Object{}.some_id);
+        }
+    }
+
+    // the `SET` values are bound before the `WHERE` values
+    query.rebind(std::string("rebound"), 8, 9);
+    query.exec();
+
+    auto rebound = my_conn->select_query<Object>().where_many(table_t::field_t<"some_id">() == 8).exec().to_vector();
+    ASSERT_EQ(rebound.size(), 1);
+    ASSERT_EQ(rebound[0].id, 10);
+    ASSERT_EQ(rebound[0].some_text, "rebound");
+}
+
+TEST_F(QueryTest, DeleteMany)
+{
+    my_conn->insert_many_records(std::vector<Object>(1000));
+
+    // every even id
+    auto ids = std::views::iota(1, 501) | std::views::transform([](int i) { return i * 2; });
+    ASSERT_EQ(my_conn->delete_many_records<Object>(ids), 500);
+
+    std::vector<int> more_ids = { 1, 3, 2, 4000 };
+    ASSERT_EQ(my_conn->delete_many_records<Object>(more_ids), 2);
+
+    auto remaining = my_conn->select_query<Object>().many().exec().to_vector();
+    ASSERT_EQ(remaining.size(), 498);
+    for (const auto& o : remaining) {
+        ASSERT_EQ(o.id % 2, 1);
+        ASSERT_GT(o.id, 3);
+    }
+}
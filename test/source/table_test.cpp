@@ -137,3 +137,48 @@ TEST_F(TableTest, CreateWithStrings) {
     ASSERT_EQ(trimmed, expected);
 }
 
+TEST_F(TableTest, StaticInsertQuery) {
+    static_assert(table_t::static_insert_query() == "INSERT INTO `test` (`id`, `name`) VALUES (?, ?);");
+    static_assert(table_with_strings_t::static_insert_query<2>() ==
+        "INSERT INTO `test_strings` (`id`, `opt_text`, `text`, `more_text`, `not_null_text`) "
+        "VALUES (NULL, ?, ?, ?, ?), (NULL, ?, ?, ?, ?);");
+
+    // the rowids are bound when they are set
+    static_assert(table_with_strings_t::static_insert_query<1, true>() ==
+        "INSERT INTO `test_strings` (`id`, `opt_text`, `text`, `more_text`, `not_null_text`) "
+        "VALUES (?, ?, ?, ?, ?);");
+    static_assert(table_with_strings_t::static_max_rowid_query() == "SELECT max(`id`) FROM `test_strings`;");
+
+    ASSERT_EQ(table_with_strings_t::insert_query(3), table_with_strings_t::static_insert_query<3>());
+    ASSERT_EQ(table_with_strings_t::insert_query(100).size(), table_with_strings_t::insert_query(99).size() + 20);
+    ASSERT_FALSE(table_with_strings_t::find_static_insert_query(100).has_value());
+}
+
+TEST_F(TableTest, StaticUpdateQuery) {
+    static_assert(table_with_strings_t::static_update_query() ==
+        "UPDATE `test_strings` SET `opt_text` = ?, `text` = ?, `more_text` = ?, `not_null_text` = ? WHERE `id` = ?;");
+}
+
+TEST_F(TableTest, StaticUpsertQuery) {
+    static_assert(table_with_strings_t::static_upsert_query<1, true>() ==
+        "INSERT INTO `test_strings` (`id`, `opt_text`, `text`, `more_text`, `not_null_text`) "
+        "VALUES (NULLIF(?, 0), ?, ?, ?, ?) "
+        "ON CONFLICT (`id`) DO UPDATE SET `opt_text` = excluded.`opt_text`, `text` = excluded.`text`, "
+        "`more_text` = excluded.`more_text`, `not_null_text` = excluded.`not_null_text` "
+        "RETURNING `id`;");
+}
+
+TEST_F(TableTest, ReadPlan) {
+    using t = table_with_strings_t;
+    static_assert(t::column_type_is_known<t::column_by_name<"id">::type>);
+    static_assert(t::column_type_is_known<t::column_by_name<"not_null_text">::type>);
+    // nullable, or NULL can be inserted explicitly
+    static_assert(not t::column_type_is_known<t::column_by_name<"opt_text">::type>);
+    static_assert(not t::column_type_is_known<t::column_by_name<"text">::type>);
+    static_assert(not t::column_type_is_known<t::column_by_name<"more_text">::type>);
+}
+
+TEST_F(TableTest, StaticCreateTableQuery) {
+    ASSERT_EQ(table_with_column_constraints_t::create_table_query(true),
+        table_with_column_constraints_t::static_create_table_query<true>());
+}
@@ -0,0 +1,115 @@
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <stdexcept>
+#include "zxorm/zxorm.hpp"
+#include "logger.hpp"
+
+using namespace zxorm;
+
+struct Account {
+    int id = 0;
+    int balance = 0;
+};
+
+using account_table_t = Table<"accounts", Account,
+    Column<"id", &Account::id, PrimaryKey<>>,
+    Column<"balance", &Account::balance>
+>;
+
+using transaction_connection_t = Connection<account_table_t>;
+
+class TransactionTest : public ::testing::Test {
+    protected:
+    void SetUp() override {
+        my_conn = std::make_shared<transaction_connection_t>("test.db", 0, nullptr, &logger);
+        my_conn->create_tables();
+    }
+
+    std::shared_ptr<transaction_connection_t> my_conn;
+
+    size_t n_accounts() {
+        return my_conn->select_query<Count<account_table_t>>().one().exec().value();
+    }
+
+    void TearDown() override {
+        my_conn = nullptr;
+        std::filesystem::remove("test.db");
+    }
+};
+
+TEST_F(TransactionTest, CommitAndRollback)
+{
+    {
+        auto transaction = my_conn->begin_transaction();
+        my_conn->insert_record(Account{});
+        transaction.commit();
+        ASSERT_FALSE(transaction.is_open());
+        ASSERT_THROW(transaction.commit(), InternalError);
+    }
+    ASSERT_EQ(n_accounts(), 1);
+
+    {
+        auto transaction = my_conn->begin_transaction();
+        my_conn->insert_record(Account{});
+        // destroyed without committing
+    }
+    ASSERT_EQ(n_accounts(), 1);
+
+    // any exception rolls back, not just ours
+    ASSERT_THROW(my_conn->transaction([&]() {
+        my_conn->insert_record(Account{});
+        throw std::runtime_error("oops");
+    }), std::runtime_error);
+    ASSERT_EQ(n_accounts(), 1);
+}
+
+TEST_F(TransactionTest, NestedSavepoints)
+{
+    auto outer = my_conn->begin_transaction(transaction_mode_t::immediate);
+    my_conn->insert_record(Account{ .balance = 1 });
+
+    {
+        auto inner = my_conn->begin_transaction();
+        ASSERT_EQ(inner.level(), 2);
+        my_conn->insert_record(Account{ .balance = 2 });
+
+        {
+            auto innermost = my_conn->begin_transaction();
+            my_conn->insert_record(Account{ .balance = 3 });
+            innermost.commit();
+        }
+        ASSERT_EQ(n_accounts(), 3);
+
+        // the outer transaction can't end first
+        ASSERT_THROW(outer.commit(), InternalError);
+
+        inner.rollback();
+    }
+    ASSERT_EQ(n_accounts(), 1);
+
+    // inserting many records nests into the open transaction
+    my_conn->insert_many_records(std::vector<Account>(4));
+    outer.commit();
+
+    ASSERT_EQ(n_accounts(), 5);
+    ASSERT_EQ(my_conn->first<Account>()->balance, 1);
+}
+
+TEST_F(TransactionTest, ImmediateTakesTheWriteLock)
+{
+    transaction_connection_t other("test.db", 0, nullptr, &logger);
+
+    auto transaction = my_conn->begin_transaction(transaction_mode_t::immediate);
+    ASSERT_THROW(auto _ = other.begin_transaction(transaction_mode_t::immediate), SQLExecutionError);
+
+    // a deferred transaction only locks once it is used
+    auto deferred = other.begin_transaction(transaction_mode_t::deferred);
+    ASSERT_THROW(other.insert_record(Account{}), SQLExecutionError);
+    deferred.rollback();
+
+    transaction.commit();
+    auto retried = other.begin_transaction(transaction_mode_t::immediate);
+    other.insert_record(Account{});
+    retried.commit();
+    ASSERT_EQ(n_accounts(), 1);
+}
@@ -0,0 +1,135 @@
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <future>
+#include <stdexcept>
+#include <thread>
+#include "zxorm/zxorm.hpp"
+#include "logger.hpp"
+
+using namespace zxorm;
+
+struct QueuedObject {
+    int id = 0;
+    int producer = 0;
+};
+
+using queued_table_t = Table<"queued", QueuedObject,
+    Column<"id", &QueuedObject::id, PrimaryKey<>>,
+    Column<"producer", &QueuedObject::producer>
+>;
+
+struct UniqueObject {
+    int id = 0;
+    int number = 0;
+};
+
+// a conflict rolls back the whole transaction, not just the statement
+using unique_table_t = Table<"unique_numbers", UniqueObject,
+    Column<"id", &UniqueObject::id, PrimaryKey<>>,
+    Column<"number", &UniqueObject::number, Unique<conflict_t::rollback>>
+>;
+
+using write_queue_t = WriteQueue<queued_table_t, unique_table_t>;
+
+class WriteQueueTest : public ::testing::Test {
+    protected:
+    void SetUp() override {
+        queue = std::make_shared<write_queue_t>("test.db", write_queue_options_t{ .max_batch_size = 64 },
+                ConnectionOptions{}, &logger);
+        queue->create_tables().get();
+    }
+
+    std::shared_ptr<write_queue_t> queue;
+
+    size_t count() {
+        return queue->submit([](auto& c) {
+            return c.template select_query<Count<queued_table_t>>().one().exec().value();
+        }).get();
+    }
+
+    void TearDown() override {
+        queue = nullptr;
+        std::filesystem::remove("test.db");
+    }
+};
+
+TEST_F(WriteQueueTest, GroupsConcurrentWrites)
+{
+    constexpr int n_producers = 8;
+    constexpr int n_writes = 200;
+
+    std::vector<std::thread> producers;
+    for (int p = 0; p < n_producers; p++) {
+        producers.emplace_back([&, p]() {
+            std::vector<AsyncResult<QueuedObject>> results;
+            for (int i = 0; i < n_writes; i++) {
+                results.push_back(queue->insert_record(QueuedObject{ .producer = p }));
+            }
+            for (auto& result : results) {
+                ASSERT_GT(result.get().id, 0);
+            }
+        });
+    }
+    for (auto& t : producers) {
+        t.join();
+    }
+
+    ASSERT_EQ(count(), n_producers * n_writes);
+
+    auto stats = queue->stats();
+    ASSERT_EQ(stats.failed, 0);
+    ASSERT_LE(stats.largest_batch, 64);
+    // the create & count requests are in there too
+    ASSERT_EQ(stats.requests, n_producers * n_writes + 2);
+    ASSERT_LT(stats.transactions, stats.requests);
+}
+
+TEST_F(WriteQueueTest, FailedRequestsAreRolledBackAlone)
+{
+    auto before = queue->insert_record(QueuedObject{});
+    auto failed = queue->submit([](auto& c) {
+        c.insert_record(QueuedObject{ .producer = 1 });
+        throw std::runtime_error("oops");
+    });
+    auto after = queue->insert_record(QueuedObject{});
+
+    ASSERT_EQ(before.get().id, 1);
+    ASSERT_THROW(failed.get(), std::runtime_error);
+    ASSERT_EQ(after.get().id, 2);
+    ASSERT_EQ(count(), 2);
+    ASSERT_EQ(queue->stats().failed, 1);
+}
+
+TEST_F(WriteQueueTest, RequestsAfterARollbackAreNotRun)
+{
+    queue->insert_record(UniqueObject{ .number = 1 }).get();
+
+    // holds up the queue, so the next requests are all in one batch (which the blocker may be part of)
+    std::promise<void> release;
+    auto blocker = queue->submit([waiting = release.get_future().share()](auto&) { waiting.wait(); });
+    auto before = queue->insert_record(UniqueObject{ .number = 2 });
+    auto conflict = queue->insert_record(UniqueObject{ .number = 1 });
+    auto after = queue->insert_record(UniqueObject{ .number = 3 });
+    release.set_value();
+
+    ASSERT_THROW(before.get(), InternalError);
+    ASSERT_THROW(conflict.get(), SQLConstraintError);
+    ASSERT_THROW(after.get(), InternalError);
+
+    auto n_unique = queue->submit([](auto& c) {
+        return c.template select_query<Count<unique_table_t>>().one().exec().value();
+    }).get();
+    ASSERT_EQ(n_unique, 1);
+    ASSERT_GE(queue->stats().failed, 3);
+}
+
+TEST_F(WriteQueueTest, DestructorCommitsQueuedWrites)
+{
+    for (int i = 0; i < 100; i++) {
+        auto _ = queue->insert_record(QueuedObject{});
+    }
+    queue = nullptr;
+
+    Connection<queued_table_t> connection("test.db");
+    ASSERT_EQ(connection.select_query<Count<queued_table_t>>().one().exec(), 100);
+}